@@ -0,0 +1,75 @@
+#include "AgentStore.h"
+
+static AlignedAllocationCounter aligned_allocation_counter = NULL;
+
+void setAlignedAllocationCounter(AlignedAllocationCounter counter)
+{
+	aligned_allocation_counter = counter;
+}
+
+AlignedAllocationCounter alignedAllocationCounter()
+{
+	return aligned_allocation_counter;
+}
+
+AgentStore::AgentStore(int count)
+{
+	seed = 0;
+	tick = 0;
+	new_infections = 0;
+	new_recoveries = 0;
+	susceptible = 0;
+	infected = 0;
+	recovered = 0;
+	resize(count);
+}
+
+//Changes the number of agents. New agents start at the origin, standing still and susceptible. The agents are given ids afresh
+//in the order they're stored.
+void AgentStore::resize(int count)
+{
+	x.resize(count, 0.0);
+	y.resize(count, 0.0);
+	vx.resize(count, 0.0);
+	vy.resize(count, 0.0);
+	radius.resize(count, 1.0);
+	state.resize(count, SUSCEPTIBLE);
+	resetOrder();
+	recount();
+}
+
+//Numbers the agents in the order they're stored now
+void AgentStore::resetOrder()
+{
+	id.resize(size());
+	index_of.resize(size());
+	for (int agent = 0;agent < size();agent++) {
+		id[agent] = agent;
+		index_of[agent] = agent;
+	}
+}
+
+//Counts the agents in each state from scratch
+void AgentStore::recount()
+{
+	susceptible = 0;
+	infected = 0;
+	recovered = 0;
+
+	for (int agent = 0;agent < size();agent++) {
+		susceptible += (state[agent] & SUSCEPTIBLE) != 0;
+		infected += (state[agent] & INFECTED) != 0;
+		recovered += (state[agent] & RECOVERED) != 0;
+	}
+}
+
+int AgentStore::size()
+{
+	return (int)x.size();
+}
+
+//How much memory a single agent takes up across all of the arrays
+size_t AgentStore::bytesPerAgent()
+{
+	return 5 * sizeof(double) + sizeof(unsigned char) + sizeof(unsigned int) + sizeof(int);
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+using namespace std;
+
+//Lets a tool such as the benchmark see the memory the aligned arrays use, since it doesn't go through new. The counter is told
+//the size of every block when it's allocated, and minus the size when it's freed. Only set it while no simulation is running.
+typedef void (*AlignedAllocationCounter)(long long bytes);
+void setAlignedAllocationCounter(AlignedAllocationCounter counter);
+AlignedAllocationCounter alignedAllocationCounter();
+
+//Hands out memory aligned to a cache line so that every array in the store starts on a boundary that SIMD loads like
+template <class T, size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+
+	template <class U>
+	struct rebind {
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() {}
+	template <class U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+	T *allocate(size_t count)
+	{
+		void *memory;
+#ifdef _WIN32
+		memory = _aligned_malloc(count * sizeof(T), Alignment);
+#else
+		if (posix_memalign(&memory, Alignment, count * sizeof(T)) != 0)
+			memory = NULL;
+#endif
+		if (memory == NULL)
+			throw bad_alloc();
+		if (alignedAllocationCounter() != NULL)
+			alignedAllocationCounter()((long long)(count * sizeof(T)));
+		return (T *)memory;
+	}
+
+	void deallocate(T *memory, size_t count)
+	{
+		if (alignedAllocationCounter() != NULL)
+			alignedAllocationCounter()(-(long long)(count * sizeof(T)));
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+
+	template <class U>
+	bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+	template <class U>
+	bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+template <class T>
+using AlignedVector = vector<T, AlignedAllocator<T> >;
+
+//Where an agent is in the course of the disease. Each state gets its own bit, so checking against several states at once is a
+//single mask test. New states (exposed, quarantined, ...) can be added as further bits.
+enum AgentState : unsigned char
+{
+	SUSCEPTIBLE = 1 << 0,
+	INFECTED = 1 << 1,
+	RECOVERED = 1 << 2
+};
+
+//One agent passing the disease to another: the tick it happened in, who passed it on, who caught it and where the two of them
+//touched
+struct Transmission
+{
+	unsigned int tick;
+	unsigned int infector;
+	unsigned int infectee;
+	float x;
+	float y;
+};
+
+//Holds every agent (circle/person) in the simulation as a structure of arrays. Agent i is made up of x[i], y[i], vx[i] and so on.
+//Keeping each attribute in its own contiguous array means the motion and collision loops stream through memory instead of
+//chasing a pointer per circle, and the compiler is free to vectorize them.
+class AgentStore
+{
+public:
+	AlignedVector<double> x;
+	AlignedVector<double> y;
+	AlignedVector<double> vx;
+	AlignedVector<double> vy;
+	AlignedVector<double> radius;
+	AlignedVector<unsigned char> state;
+
+	//Every agent's id, which stays with it however the arrays get reordered, and where the agent with each id is stored now.
+	//Random numbers, transmissions and checkpoints all go by id, so moving agents around in memory never changes a run.
+	AlignedVector<unsigned int> id;
+	vector<int> index_of;
+
+	//The seed every random number in the run is drawn from, and how many ticks have gone by. Together with an agent's index
+	//these pick out its random numbers (see Random.h).
+	unsigned long long seed;
+	unsigned int tick;
+
+	//How many agents are in each state right now. The simulation keeps these up to date as agents change state, so nothing has to
+	//look through every agent to find out. Anything else that writes to the state array directly has to call recount() after.
+	int susceptible;
+	int infected;
+	int recovered;
+
+	//How many agents caught the disease and how many recovered during the last tick
+	unsigned int new_infections;
+	unsigned int new_recoveries;
+
+	//Every infection of the last tick, in the order they happened
+	vector<Transmission> transmissions;
+
+	AgentStore(int count=0);
+	void resize(int count);
+	void resetOrder();
+	void recount();
+	int size();
+	size_t bytesPerAgent();
+};
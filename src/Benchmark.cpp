@@ -0,0 +1,430 @@
+//Times the simulation kernels across a range of population sizes, packing densities and speeds. Each case prints a line to the
+//console and is written as a row of a CSV table, so runs from different commits can be lined up and compared. Passing the table
+//from an earlier run with --baseline prints how much faster or slower each case got.
+
+//Allows output messages
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+//Command line parsing
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+
+//Timing and allocation counting
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+//Counting cache misses
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//Circle motion, collision and infection
+#include "Simulation.h"
+
+//Choosing the SIMD kernels
+#include "SimdKernels.h"
+
+using namespace std;
+
+//Every allocation made through new or by the store's aligned arrays is counted, along with how many bytes are currently in use
+//and the most there has been. The size of each block from new is kept just in front of it so it can be taken off again when
+//the block is freed.
+static atomic<long long> allocation_count(0);
+static atomic<long long> allocation_bytes(0);
+static atomic<long long> live_bytes(0);
+static atomic<long long> peak_live_bytes(0);
+
+//Big enough to keep whatever comes after it aligned for any type
+#define ALLOCATION_HEADER 16
+
+static void *countedAllocate(size_t size)
+{
+	char *block = (char *)malloc(size + ALLOCATION_HEADER);
+	if (block == NULL) {
+		return NULL;
+	}
+	*(size_t *)block = size;
+
+	allocation_count++;
+	allocation_bytes += size;
+	long long live = live_bytes += size;
+	long long peak = peak_live_bytes.load();
+	while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live)) {
+	}
+
+	return block + ALLOCATION_HEADER;
+}
+
+//The aligned arrays report their own blocks, with a negative size when one is freed, so they don't need a header
+static void countAlignedAllocation(long long bytes)
+{
+	if (bytes < 0) {
+		live_bytes += bytes;
+		return;
+	}
+
+	allocation_count++;
+	allocation_bytes += bytes;
+	long long live = live_bytes += bytes;
+	long long peak = peak_live_bytes.load();
+	while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live)) {
+	}
+}
+
+static void countedFree(void *memory)
+{
+	if (memory == NULL) {
+		return;
+	}
+	char *block = (char *)memory - ALLOCATION_HEADER;
+	live_bytes -= *(size_t *)block;
+	free(block);
+}
+
+void *operator new(size_t size)
+{
+	void *memory = countedAllocate(size);
+	if (memory == NULL) {
+		throw bad_alloc();
+	}
+	return memory;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const nothrow_t &) noexcept { return countedAllocate(size); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return countedAllocate(size); }
+void operator delete(void *memory) noexcept { countedFree(memory); }
+void operator delete[](void *memory) noexcept { countedFree(memory); }
+void operator delete(void *memory, size_t) noexcept { countedFree(memory); }
+void operator delete[](void *memory, size_t) noexcept { countedFree(memory); }
+void operator delete(void *memory, const nothrow_t &) noexcept { countedFree(memory); }
+void operator delete[](void *memory, const nothrow_t &) noexcept { countedFree(memory); }
+
+//Last level cache misses are counted with the kernel's performance counters on Linux. The counter is opened before the simulation's
+//threads are started so that they inherit it, and reading it adds up every thread. Anywhere the counters can't be used, the
+//column says n/a.
+static int cache_miss_counter = -1;
+
+static void openCacheMissCounter()
+{
+#ifdef __linux__
+	struct perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = PERF_TYPE_HARDWARE;
+	attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+	attributes.disabled = 1;
+	attributes.inherit = 1;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	cache_miss_counter = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+}
+
+static void startCountingCacheMisses()
+{
+#ifdef __linux__
+	if (cache_miss_counter >= 0) {
+		ioctl(cache_miss_counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(cache_miss_counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+//Returns the misses since counting started, or -1 if they can't be counted
+static long long stopCountingCacheMisses()
+{
+#ifdef __linux__
+	long long misses;
+	if (cache_miss_counter >= 0) {
+		ioctl(cache_miss_counter, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(cache_miss_counter, &misses, sizeof(misses)) == sizeof(misses)) {
+			return misses;
+		}
+	}
+#endif
+	return -1;
+}
+
+//What gets timed
+enum BenchmarkKernel
+{
+	//A whole tick: collisions, infection, recovery and movement
+	KERNEL_MOTION,
+	//Collisions, infection and recovery on their own, without anything moving between ticks
+	KERNEL_COLLISION
+};
+
+struct BenchmarkResult
+{
+	string kernel;
+	int agents;
+	double packing;
+	float sim_speed;
+	int ticks;
+	double ns_per_agent_tick;
+	double allocations_per_tick;
+	double allocated_bytes_per_tick;
+	long long agent_bytes;
+	long long peak_heap_bytes;
+	//Negative if the misses couldn't be counted
+	double cache_misses_per_tick;
+};
+
+BenchmarkResult runBenchmark(BenchmarkKernel kernel, int agents, double packing, float sim_speed, long long work, unsigned long long seed);
+void readBaseline(const string &path, map<string, double> &baseline);
+string resultKey(const string &kernel, int agents, double packing, float sim_speed);
+void printUsage();
+
+int main(int argc, char **argv)
+{
+	int max_agents = 1000000;
+	long long work = 5000000;
+	int threads = 0;
+	int max_substeps = MAX_SUBSTEPS;
+	unsigned long long seed = 1;
+	string output_path = "benchmark.csv";
+	string baseline_path;
+	string label = "current";
+	string simd = "auto";
+
+	//Read the parameters from the command line
+	for (int arg = 1;arg < argc;arg++) {
+		bool has_value = arg + 1 < argc;
+
+		if (strcmp(argv[arg], "--max-agents") == 0 && has_value) {
+			max_agents = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--work") == 0 && has_value) {
+			work = atoll(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--threads") == 0 && has_value) {
+			threads = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--max-substeps") == 0 && has_value) {
+			max_substeps = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--seed") == 0 && has_value) {
+			seed = strtoull(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--simd") == 0 && has_value) {
+			simd = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--output") == 0 && has_value) {
+			output_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--baseline") == 0 && has_value) {
+			baseline_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--label") == 0 && has_value) {
+			label = argv[++arg];
+		}
+		else {
+			printUsage();
+			return strcmp(argv[arg], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (work <= 0) {
+		cout << "The amount of work per case must be positive" << endl;
+		return 1;
+	}
+
+	SimdLevel simd_level;
+	if (!simdLevelFromName(simd, simd_level)) {
+		cout << "The SIMD level must be auto, scalar, sse2, avx2 or avx512" << endl;
+		return 1;
+	}
+
+	//Before the simulation's threads exist, so that they're counted too
+	openCacheMissCounter();
+
+	setSimulationThreads(threads);
+	setMaxSubsteps(max_substeps);
+	setSimdLevel(simd_level);
+	setAlignedAllocationCounter(countAlignedAllocation);
+	if (threads <= 0) {
+		threads = max(1, (int)thread::hardware_concurrency());
+	}
+
+	map<string, double> baseline;
+	if (!baseline_path.empty()) {
+		readBaseline(baseline_path, baseline);
+		if (baseline.empty()) {
+			cout << "No results found in " << baseline_path << endl;
+			return 1;
+		}
+	}
+
+	ofstream output(output_path.c_str());
+	if (!output) {
+		cout << "Failed to open " << output_path << endl;
+		return 1;
+	}
+	output << "label,kernel,agents,packing,speed,threads,ticks,ns_per_agent_tick,allocations_per_tick,allocated_bytes_per_tick,agent_bytes,peak_heap_bytes,llc_misses_per_tick" << endl;
+
+	//The cases: from the size the window starts with up to a million agents, from sparse to crowded, at normal and fast speed.
+	//Packing is the fraction of the screen covered by circles.
+	int sizes[] = { 30, 1000, 10000, 100000, 1000000 };
+	double packings[] = { 0.05, 0.2, 0.4 };
+	float speeds[] = { 1.0f, 5.0f };
+	BenchmarkKernel kernels[] = { KERNEL_MOTION, KERNEL_COLLISION };
+
+	printf("Using the %s kernels\n", simdLevelName(simdLevel()));
+	if (cache_miss_counter < 0) {
+		printf("Cache misses can't be counted here\n");
+	}
+	printf("%-16s %8s %8s %6s %7s %13s %11s %16s %12s %14s %15s", "kernel", "agents", "packing", "speed", "ticks", "ns/agent/tick", "allocs/tick", "alloc bytes/tick", "agent bytes", "peak heap", "LLC misses/tick");
+	printf(baseline.empty() ? "\n" : " %8s\n", "speedup");
+
+	for (int kernel = 0;kernel < sizeof(kernels) / sizeof(kernels[0]);kernel++) {
+		for (int size = 0;size < sizeof(sizes) / sizeof(sizes[0]);size++) {
+			if (sizes[size] > max_agents) {
+				continue;
+			}
+			for (int packing = 0;packing < sizeof(packings) / sizeof(packings[0]);packing++) {
+				for (int speed = 0;speed < sizeof(speeds) / sizeof(speeds[0]);speed++) {
+					BenchmarkResult result = runBenchmark(kernels[kernel], sizes[size], packings[packing], speeds[speed], work, seed);
+
+					printf("%-16s %8d %8.2f %6.1f %7d %13.2f %11.2f %16.0f %12lld %14lld", result.kernel.c_str(), result.agents, result.packing, result.sim_speed,
+						result.ticks, result.ns_per_agent_tick, result.allocations_per_tick, result.allocated_bytes_per_tick, result.agent_bytes, result.peak_heap_bytes);
+					if (result.cache_misses_per_tick < 0.0) {
+						printf(" %15s", "n/a");
+					}
+					else {
+						printf(" %15.0f", result.cache_misses_per_tick);
+					}
+					if (!baseline.empty()) {
+						map<string, double>::iterator previous = baseline.find(resultKey(result.kernel, result.agents, result.packing, result.sim_speed));
+						if (previous == baseline.end()) {
+							printf(" %8s", "-");
+						}
+						else {
+							printf(" %7.2fx", previous->second / result.ns_per_agent_tick);
+						}
+					}
+					printf("\n");
+					fflush(stdout);
+
+					output << label << "," << result.kernel << "," << result.agents << "," << result.packing << "," << result.sim_speed << "," << threads << "," << result.ticks << ","
+						<< result.ns_per_agent_tick << "," << result.allocations_per_tick << "," << result.allocated_bytes_per_tick << "," << result.agent_bytes << "," << result.peak_heap_bytes << ",";
+					if (result.cache_misses_per_tick < 0.0) {
+						output << "n/a" << endl;
+					}
+					else {
+						output << result.cache_misses_per_tick << endl;
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+//Sets up a population and times the kernel on it. Every case does roughly the same number of agent-ticks of work, so small
+//populations run for many ticks and big ones for only a few.
+BenchmarkResult runBenchmark(BenchmarkKernel kernel, int agents, double packing, float sim_speed, long long work, unsigned long long seed)
+{
+	BenchmarkResult result;
+	result.kernel = kernel == KERNEL_MOTION ? "circleMotion" : "circleCollision";
+	result.agents = agents;
+	result.packing = packing;
+	result.sim_speed = sim_speed;
+	result.ticks = (int)max(5LL, min(20000LL, work / agents));
+
+	//The radius that makes the circles cover the given fraction of the 2x2 screen
+	double radius = sqrt(packing * 4.0 / (agents * PI));
+
+	AgentStore circles(agents);
+	createCircles(circles, seed, radius);
+
+	//Warm up so the grid and contact lists have grown to size and the circles aren't still in their starting heap
+	int warmup = max(1, result.ticks / 10);
+	for (int tick = 0;tick < warmup;tick++) {
+		circleMotion(circles, true, 1.0f, 5.0f, sim_speed);
+	}
+
+	long long count_before = allocation_count.load();
+	long long bytes_before = allocation_bytes.load();
+	peak_live_bytes.store(live_bytes.load());
+
+	startCountingCacheMisses();
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int tick = 0;tick < result.ticks;tick++) {
+		if (kernel == KERNEL_MOTION) {
+			circleMotion(circles, true, 1.0f, 5.0f, sim_speed);
+		}
+		else {
+			circleCollision(circles, true, 1.0f, 5.0f, sim_speed);
+		}
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	long long cache_misses = stopCountingCacheMisses();
+
+	result.ns_per_agent_tick = seconds * 1e9 / ((double)agents * result.ticks);
+	result.allocations_per_tick = (double)(allocation_count.load() - count_before) / result.ticks;
+	result.allocated_bytes_per_tick = (double)(allocation_bytes.load() - bytes_before) / result.ticks;
+	result.agent_bytes = (long long)(agents * circles.bytesPerAgent());
+	result.peak_heap_bytes = peak_live_bytes.load();
+	result.cache_misses_per_tick = cache_misses < 0 ? -1.0 : (double)cache_misses / result.ticks;
+
+	return result;
+}
+
+//Picks a case out of a results table
+string resultKey(const string &kernel, int agents, double packing, float sim_speed)
+{
+	ostringstream key;
+	key << kernel << "," << agents << "," << packing << "," << sim_speed;
+	return key.str();
+}
+
+//Reads the ns/agent/tick of every case in a table written by an earlier run
+void readBaseline(const string &path, map<string, double> &baseline)
+{
+	ifstream input(path.c_str());
+	string line;
+
+	//Skip the header
+	getline(input, line);
+
+	while (getline(input, line)) {
+		vector<string> fields;
+		stringstream columns(line);
+		string field;
+		while (getline(columns, field, ',')) {
+			fields.push_back(field);
+		}
+		if (fields.size() < 8) {
+			continue;
+		}
+		baseline[resultKey(fields[1], atoi(fields[2].c_str()), atof(fields[3].c_str()), (float)atof(fields[4].c_str()))] = atof(fields[7].c_str());
+	}
+}
+
+void printUsage()
+{
+	cout << "Usage: Benchmark [options]" << endl
+		<< "  --max-agents N         skip the cases with more agents than this (default 1000000)" << endl
+		<< "  --work N               agent-ticks to time for each case (default 5000000)" << endl
+		<< "  --threads N            worker threads, 0 for one per hardware thread (default 0)" << endl
+		<< "  --max-substeps N       most substeps a tick is split into at high speed, 1 for none (default " << MAX_SUBSTEPS << ")" << endl
+		<< "  --seed N               random seed (default 1)" << endl
+		<< "  --simd LEVEL           scalar, sse2, avx2 or avx512 kernels, or auto for the best the CPU has (default auto)" << endl
+		<< "  --output FILE          where to write the results table (default benchmark.csv)" << endl
+		<< "  --label TEXT           tag for the rows of the table, such as the commit being measured (default current)" << endl
+		<< "  --baseline FILE        results table from an earlier run to compare against" << endl;
+}
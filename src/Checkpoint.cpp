@@ -0,0 +1,315 @@
+#include "Checkpoint.h"
+
+//Writing the file and copying the arrays
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//Mapping the file into memory
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Every array starts on a multiple of this many bytes
+#define CHECKPOINT_ALIGNMENT 64
+
+//Written as a number so a file from a machine with the opposite byte order is recognised instead of misread
+#define CHECKPOINT_BYTE_ORDER 0x01020304u
+
+enum CheckpointArray
+{
+	CHECKPOINT_X,
+	CHECKPOINT_Y,
+	CHECKPOINT_VX,
+	CHECKPOINT_VY,
+	CHECKPOINT_RADIUS,
+	CHECKPOINT_STATE,
+	CHECKPOINT_ARRAYS
+};
+
+//The start of every checkpoint file. Only fixed size types, and laid out so the compiler doesn't need to add any padding.
+struct CheckpointHeader
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int byte_order;
+	unsigned int header_size;
+	unsigned int agents;
+
+	//Where the random numbers are up to
+	unsigned long long seed;
+	unsigned int tick;
+
+	//The parameters the run was going with
+	unsigned int immunity;
+	float infection_chance;
+	float average_recovery;
+	float sim_speed;
+	int max_ticks;
+	double radius;
+
+	//Where each array starts, counting from the start of the file, and how big the whole file is
+	unsigned long long array_offset[CHECKPOINT_ARRAYS];
+	unsigned long long file_size;
+
+	//FNV-1a hash of everything after the header
+	unsigned long long checksum;
+};
+
+static const char checkpoint_magic[8] = { 'C', 'O', 'N', 'T', 'A', 'C', 'T', 'S' };
+
+static unsigned long long checksumBytes(const unsigned char *bytes, size_t count)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t byte = 0;byte < count;byte++) {
+		hash = (hash ^ bytes[byte]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static size_t alignUp(size_t offset)
+{
+	return (offset + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+}
+
+//Works out where each array goes in a checkpoint of the given number of agents and returns the total size
+static size_t checkpointLayout(unsigned int agents, unsigned long long array_offset[CHECKPOINT_ARRAYS])
+{
+	size_t offset = alignUp(sizeof(CheckpointHeader));
+	for (int array = 0;array < CHECKPOINT_ARRAYS;array++) {
+		array_offset[array] = offset;
+		offset = alignUp(offset + (size_t)agents * (array == CHECKPOINT_STATE ? sizeof(unsigned char) : sizeof(double)));
+	}
+	return offset;
+}
+
+//Copies one of the agent arrays into the file in order of id, so the file is the same however the agents happen to be ordered in
+//memory. Loading it back puts every agent where its id says.
+template <class T>
+static void copyInIdOrder(unsigned char *destination, const T *source, AgentStore &circles)
+{
+	for (int agent = 0;agent < circles.size();agent++) {
+		memcpy(destination + (size_t)circles.id[agent] * sizeof(T), &source[agent], sizeof(T));
+	}
+}
+
+//Saves the simulation. Returns false and says why if the checkpoint couldn't be written; the previous checkpoint at the same path,
+//if there is one, is left as it was.
+bool saveCheckpoint(const string &path, AgentStore &circles, const ModelParameters &parameters, string &error)
+{
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.byte_order = CHECKPOINT_BYTE_ORDER;
+	header.header_size = sizeof(CheckpointHeader);
+	header.agents = (unsigned int)circles.size();
+	header.seed = circles.seed;
+	header.tick = circles.tick;
+	header.immunity = parameters.immunity;
+	header.infection_chance = parameters.infection_chance;
+	header.average_recovery = parameters.average_recovery;
+	header.sim_speed = parameters.sim_speed;
+	header.max_ticks = parameters.max_ticks;
+	header.radius = parameters.radius;
+	header.file_size = checkpointLayout(header.agents, header.array_offset);
+
+	//Lay the whole file out in memory so it goes to disk in one write
+	vector<unsigned char> file((size_t)header.file_size, 0);
+	copyInIdOrder(&file[(size_t)header.array_offset[CHECKPOINT_X]], circles.x.data(), circles);
+	copyInIdOrder(&file[(size_t)header.array_offset[CHECKPOINT_Y]], circles.y.data(), circles);
+	copyInIdOrder(&file[(size_t)header.array_offset[CHECKPOINT_VX]], circles.vx.data(), circles);
+	copyInIdOrder(&file[(size_t)header.array_offset[CHECKPOINT_VY]], circles.vy.data(), circles);
+	copyInIdOrder(&file[(size_t)header.array_offset[CHECKPOINT_RADIUS]], circles.radius.data(), circles);
+	copyInIdOrder(&file[(size_t)header.array_offset[CHECKPOINT_STATE]], circles.state.data(), circles);
+
+	size_t body = alignUp(sizeof(CheckpointHeader));
+	header.checksum = checksumBytes(&file[body], file.size() - body);
+	memcpy(&file[0], &header, sizeof(header));
+
+	//Write next to the real file first, and only swap it in once it's all there
+	string temporary_path = path + ".tmp";
+	FILE *output = fopen(temporary_path.c_str(), "wb");
+	if (output == NULL) {
+		error = "Failed to open " + temporary_path;
+		return false;
+	}
+	bool written = fwrite(file.data(), 1, file.size(), output) == file.size();
+	written = fflush(output) == 0 && written;
+#ifndef _WIN32
+	//Make sure it's actually on the disk before it replaces the old checkpoint
+	written = fsync(fileno(output)) == 0 && written;
+#endif
+	written = fclose(output) == 0 && written;
+	if (!written) {
+		remove(temporary_path.c_str());
+		error = "Failed to write " + temporary_path;
+		return false;
+	}
+
+#ifdef _WIN32
+	bool replaced = MoveFileExA(temporary_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool replaced = rename(temporary_path.c_str(), path.c_str()) == 0;
+#endif
+	if (!replaced) {
+		remove(temporary_path.c_str());
+		error = "Failed to replace " + path;
+		return false;
+	}
+	return true;
+}
+
+//A read-only view of a whole file in memory. The file is unmapped when this goes away.
+class MappedFile
+{
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int file;
+#endif
+	const unsigned char *bytes;
+	size_t length;
+
+public:
+	MappedFile(const string &path)
+	{
+		bytes = NULL;
+		length = 0;
+#ifdef _WIN32
+		mapping = NULL;
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		LARGE_INTEGER size;
+		if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			return;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			return;
+		}
+		bytes = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		length = bytes == NULL ? 0 : (size_t)size.QuadPart;
+#else
+		file = open(path.c_str(), O_RDONLY);
+		struct stat status;
+		if (file < 0 || fstat(file, &status) != 0 || status.st_size == 0) {
+			return;
+		}
+		void *view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view == MAP_FAILED) {
+			return;
+		}
+		bytes = (const unsigned char *)view;
+		length = (size_t)status.st_size;
+
+		//The arrays are read front to back
+		madvise(view, length, MADV_SEQUENTIAL);
+#endif
+	}
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (bytes != NULL) {
+			UnmapViewOfFile(bytes);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+#else
+		if (bytes != NULL) {
+			munmap((void *)bytes, length);
+		}
+		if (file >= 0) {
+			close(file);
+		}
+#endif
+	}
+
+	const unsigned char *data()
+	{
+		return bytes;
+	}
+
+	size_t size()
+	{
+		return length;
+	}
+};
+
+//Restores a simulation saved by saveCheckpoint. Returns false and says why if the file isn't a usable checkpoint, in which case
+//the circles and parameters are left untouched.
+bool loadCheckpoint(const string &path, AgentStore &circles, ModelParameters &parameters, string &error)
+{
+	MappedFile file(path);
+	if (file.data() == NULL) {
+		error = "Failed to open " + path;
+		return false;
+	}
+	if (file.size() < sizeof(CheckpointHeader)) {
+		error = path + " is too short to be a checkpoint";
+		return false;
+	}
+
+	CheckpointHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0) {
+		error = path + " isn't a checkpoint";
+		return false;
+	}
+	if (header.byte_order != CHECKPOINT_BYTE_ORDER) {
+		error = path + " was saved on a machine with a different byte order";
+		return false;
+	}
+	if (header.version != CHECKPOINT_VERSION || header.header_size != sizeof(CheckpointHeader)) {
+		error = path + " is from a different version of the program";
+		return false;
+	}
+
+	//The layout has to be exactly what this version would have written for that many agents
+	unsigned long long array_offset[CHECKPOINT_ARRAYS];
+	unsigned long long file_size = checkpointLayout(header.agents, array_offset);
+	if (file_size != header.file_size || memcmp(array_offset, header.array_offset, sizeof(array_offset)) != 0 || file.size() < file_size) {
+		error = path + " is incomplete";
+		return false;
+	}
+
+	size_t body = alignUp(sizeof(CheckpointHeader));
+	if (checksumBytes(file.data() + body, (size_t)file_size - body) != header.checksum) {
+		error = path + " is damaged (checksum mismatch)";
+		return false;
+	}
+
+	//Resizing numbers the agents in the order they're stored, which is the order of the file
+	size_t agents = header.agents;
+	circles.resize((int)agents);
+	memcpy(circles.x.data(), file.data() + header.array_offset[CHECKPOINT_X], agents * sizeof(double));
+	memcpy(circles.y.data(), file.data() + header.array_offset[CHECKPOINT_Y], agents * sizeof(double));
+	memcpy(circles.vx.data(), file.data() + header.array_offset[CHECKPOINT_VX], agents * sizeof(double));
+	memcpy(circles.vy.data(), file.data() + header.array_offset[CHECKPOINT_VY], agents * sizeof(double));
+	memcpy(circles.radius.data(), file.data() + header.array_offset[CHECKPOINT_RADIUS], agents * sizeof(double));
+	memcpy(circles.state.data(), file.data() + header.array_offset[CHECKPOINT_STATE], agents * sizeof(unsigned char));
+	circles.recount();
+	circles.seed = header.seed;
+	circles.tick = header.tick;
+
+	parameters.agents = (int)header.agents;
+	parameters.immunity = header.immunity != 0;
+	parameters.infection_chance = header.infection_chance;
+	parameters.average_recovery = header.average_recovery;
+	parameters.sim_speed = header.sim_speed;
+	parameters.max_ticks = header.max_ticks;
+	parameters.radius = header.radius;
+	return true;
+}
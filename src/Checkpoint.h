@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include "Simulation.h"
+using namespace std;
+
+//Saves and restores the whole state of a running simulation: every agent's position, velocity, radius and state, the seed and
+//tick that address the random numbers, and the parameters it was running with. Carrying on from a checkpoint gives exactly the
+//same result as if the run had never stopped.
+//
+//The file is a fixed header followed by one array per attribute, each starting on a 64 byte boundary so they line up the same
+//way as the arrays in AgentStore. It is built in memory and written with a single write to a temporary file, which then replaces
+//the old checkpoint, so a crash partway through saving leaves the previous checkpoint intact. Loading maps the file into memory
+//and copies the arrays straight out of it. A checksum over everything after the header catches files that were cut short.
+
+//Bumped whenever the layout changes. Older versions are refused rather than misread.
+#define CHECKPOINT_VERSION 1
+
+bool saveCheckpoint(const string &path, AgentStore &circles, const ModelParameters &parameters, string &error);
+bool loadCheckpoint(const string &path, AgentStore &circles, ModelParameters &parameters, string &error);
@@ -0,0 +1,231 @@
+#include "CircleRenderer.h"
+
+//Shader error messages
+#include <iostream>
+
+//Building the unit circle
+#include <cmath>
+
+//offsetof, for describing the layout of the instance buffer
+#include <cstddef>
+
+//PI
+#include "Simulation.h"
+
+//Timers for each part of a frame
+#include "Profiler.h"
+
+//Source code for the vertex shader. This program is written for OpenGL and describes how to transform the vertex data to put it on the screen
+static const char *vertexShaderSource = "#version 330 core\n"
+"layout (location=0) in vec2 position;\n" //Specifies that the position vector should be put in location 0
+
+//These come from the instance buffer and change once per circle instead of once per vertex
+"layout (location=1) in vec2 offset;\n"
+"layout (location=2) in float radius;\n"
+"layout (location=3) in uint state;\n"
+
+//The rgb color for every state, indexed by the state's bits
+"uniform vec3 stateColors[8];\n"
+
+"out VS_OUT {\n"
+"	vec4 color;\n"
+"} vs_out;\n"
+
+
+"void main()\n"
+"{\n"
+"	gl_Position=vec4(position*radius+offset,0.0,1.0);\n"
+"	vs_out.color=vec4(stateColors[state & 7u], 1.0);\n"
+"}\0";
+
+//Source code for the fragment shader. This program is also written for OpenGL and describes how to color shapes that we are passing in. It colors everything the same color.
+static const char *fragmentShaderSource = "#version 330 core\n"
+	"out vec4 FragColor;\n"
+	"in VS_OUT{\n"
+	"	vec4 color;\n"
+	"} fs_in;\n"
+	"void main()\n"
+	"{\n"
+	"   FragColor = fs_in.color;\n"
+	"}\0";
+
+//Compiles one of the shaders, printing out any error messages
+static void compileShader(GLShader &shader, const char *source, const char *name)
+{
+	glShaderSource(shader.get(), 1, &source, NULL);
+	glCompileShader(shader.get());
+
+	//Check if the shader actually built properly. It would be bad to try to render with it if it doesn't work.
+	int success;
+	char infoLog[512];
+	glGetShaderiv(shader.get(), GL_COMPILE_STATUS, &success);
+	if (!success) {
+		glGetShaderInfoLog(shader.get(), 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::" << name << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+}
+
+CircleRenderer::CircleRenderer()
+{
+	region = 0;
+	region_capacity = 0;
+
+	//Compile the two shaders and link them into one program. The shaders themselves aren't needed once it's linked, so they are
+	//deleted at the end of this block.
+	{
+		GLShader vertexShader(GL_VERTEX_SHADER);
+		GLShader fragmentShader(GL_FRAGMENT_SHADER);
+		compileShader(vertexShader, vertexShaderSource, "VERTEX");
+		compileShader(fragmentShader, fragmentShaderSource, "FRAGMENT");
+
+		glAttachShader(program.get(), vertexShader.get());
+		glAttachShader(program.get(), fragmentShader.get());
+		glLinkProgram(program.get());
+
+		//Check if the program built properly
+		int success;
+		char infoLog[512];
+		glGetProgramiv(program.get(), GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(program.get(), 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+
+		glDetachShader(program.get(), vertexShader.get());
+		glDetachShader(program.get(), fragmentShader.get());
+	}
+
+	//The colors never change, so they only need to be sent to the shader once
+	float state_colors[8][3];
+	for (int state = 0;state < 8;state++) {
+		stateColor((unsigned char)state, state_colors[state]);
+	}
+	glUseProgram(program.get());
+	glUniform3fv(glGetUniformLocation(program.get(), "stateColors"), 8, *state_colors);
+
+	//Makes a ring of vertices to draw with TRIANGLEFAN. The center is (0,0) since the vertex shader moves and scales it into place.
+	vector<float> circle((NUM_CIRCLE_VERTICES + 2) * 2, 0.0f);
+	for (int i = 1;i < NUM_CIRCLE_VERTICES + 2;i++) {
+		//The angle as measured from (0,1) clockwise
+		double angle = (i - 1) * (2 * PI) / NUM_CIRCLE_VERTICES;
+		circle[2 * i] = (float)sin(angle);
+		circle[(2 * i) + 1] = (float)cos(angle);
+	}
+
+	//The vertex array remembers how both buffers are laid out, so drawing only has to bind it
+	glBindVertexArray(vertex_array.get());
+
+	//The mesh never changes, which affects how the graphics card stores the data
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.get());
+	glBufferData(GL_ARRAY_BUFFER, circle.size() * sizeof(float), circle.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	//Each of these moves forward once per circle instead of once per vertex. Where they read from is set every frame by
+	//pointInstances, since it depends on which part of the buffer the frame used.
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer.get());
+	pointInstances(0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribDivisor(3, 1);
+
+	//Now that we've finished making all of those definitions, tell OpenGL to stop writing things to those objects so that future statements don't accidentally modify them.
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+//Points the instance attributes at the circles starting the given number of bytes into the instance buffer. The vertex array and
+//instance buffer have to be bound.
+void CircleRenderer::pointInstances(size_t offset)
+{
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (void*)(offset + offsetof(CircleInstance, x)));
+	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (void*)(offset + offsetof(CircleInstance, radius)));
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_BYTE, sizeof(CircleInstance), (void*)(offset + offsetof(CircleInstance, state)));
+}
+
+//Packs the circles straight from the arrays they're kept in. The destination is usually memory on the graphics card, which is slow
+//to read from, so every instance is written whole and front to back, and never read.
+void CircleRenderer::fillInstances(const float *x, const float *y, const float *radius, const unsigned char *state, int count, CircleInstance *destination)
+{
+	for (int circle = 0;circle < count;circle++) {
+		CircleInstance instance;
+		instance.x = x[circle];
+		instance.y = y[circle];
+		instance.radius = radius[circle];
+		instance.state = state[circle];
+		instance.padding[0] = 0;
+		instance.padding[1] = 0;
+		instance.padding[2] = 0;
+		destination[circle] = instance;
+	}
+}
+
+//Draws every circle with a single call. The positions, sizes and states are written into the next part of the instance buffer, and
+//the graphics card repeats the unit circle once for each entry in it.
+void CircleRenderer::draw(const float *x, const float *y, const float *radius, const unsigned char *state, int count)
+{
+	PROFILE_SCOPE("drawCircles");
+
+	if (count == 0) {
+		return;
+	}
+
+	glBindVertexArray(vertex_array.get());
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer.get());
+
+	//More circles than fit. Orphan the old storage by asking for a new, bigger block: the driver hands over fresh memory straight
+	//away and frees the old block once the draws still reading it are done, so there's nothing to wait for. Leave some room so a
+	//few more circles don't mean doing this again.
+	if (count > region_capacity) {
+		region_capacity = count + count / 4;
+		glBufferData(GL_ARRAY_BUFFER, region_capacity * INSTANCE_REGIONS * sizeof(CircleInstance), NULL, GL_STREAM_DRAW);
+		for (int fence = 0;fence < INSTANCE_REGIONS;fence++) {
+			region_fences[fence].clear();
+		}
+		region = 0;
+	}
+
+	//Only wait if the graphics card is still drawing from this part, from INSTANCE_REGIONS frames ago
+	region_fences[region].wait();
+
+	//Map just this part without synchronizing, since the fence already showed nothing is using it. Without the flag the driver
+	//would stall until every earlier draw from the buffer was done.
+	size_t offset = region * region_capacity * sizeof(CircleInstance);
+	size_t size = count * sizeof(CircleInstance);
+	CircleInstance *mapped = (CircleInstance *)glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (mapped != NULL) {
+		fillInstances(x, y, radius, state, count, mapped);
+		if (!glUnmapBuffer(GL_ARRAY_BUFFER)) {
+			//The memory was lost (the screen mode changed, say), so the contents have to be sent again
+			mapped = NULL;
+		}
+	}
+	if (mapped == NULL) {
+		instances.resize(count);
+		fillInstances(x, y, radius, state, count, instances.data());
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, instances.data());
+	}
+	pointInstances(offset);
+
+	//Tells OpenGL to use the shaders that we custom made
+	glUseProgram(program.get());
+
+	//Draw the circles. Yay!
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, NUM_CIRCLE_VERTICES + 2, count);
+	region_fences[region].place();
+	region = (region + 1) % INSTANCE_REGIONS;
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+//Picks the color each state is drawn with: blue for susceptible, red for infected and green for recovered
+void stateColor(unsigned char state, float color[3])
+{
+	color[0] = (state & INFECTED) ? 1.0f : 0.0f;
+	color[1] = (state & RECOVERED) ? 1.0f : 0.0f;
+	color[2] = (state & SUSCEPTIBLE) ? 1.0f : 0.0f;
+}
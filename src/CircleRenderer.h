@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include "GLResources.h"
+using namespace std;
+
+//Draws every circle as an instance of a single unit circle mesh. The mesh, the shaders and the buffers are all made once, when the
+//renderer is made, and kept until it goes away, so starting the simulation over never touches the graphics card, and adding circles
+//at most grows the instance buffer. It has to be made after the OpenGL context and destroyed before it.
+
+//How many points go around the edge of the unit circle
+#define NUM_CIRCLE_VERTICES 100
+
+//How many frames' worth of circles the instance buffer holds at once
+#define INSTANCE_REGIONS 3
+
+//What gets sent to the graphics card for each circle. Floats are plenty for drawing, and it packs into 16 bytes.
+struct CircleInstance
+{
+	float x;
+	float y;
+	float radius;
+	unsigned char state;
+	unsigned char padding[3];
+};
+
+class CircleRenderer
+{
+	GLProgram program;
+
+	//The unit circle, as a fan of 2D points around the centre
+	GLBuffer mesh;
+	GLVertexArray vertex_array;
+
+	//The circle positions, sizes and states are streamed through this every frame. It is split into INSTANCE_REGIONS parts used in
+	//turn, each with a fence marking the last draw that read from it, so a frame only has to wait if the graphics card is that many
+	//frames behind.
+	GLBuffer instance_buffer;
+	GLFence region_fences[INSTANCE_REGIONS];
+	int region;
+	size_t region_capacity;
+
+	//Only used if the buffer can't be mapped
+	vector<CircleInstance> instances;
+
+	void fillInstances(const float *x, const float *y, const float *radius, const unsigned char *state, int count, CircleInstance *destination);
+	void pointInstances(size_t offset);
+
+public:
+	CircleRenderer();
+	void draw(const float *x, const float *y, const float *radius, const unsigned char *state, int count);
+};
+
+//Picks the color each state is drawn with
+void stateColor(unsigned char state, float color[3]);
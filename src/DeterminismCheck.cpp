@@ -0,0 +1,178 @@
+//Checks that the simulation gives exactly the same results however many threads it runs on. Each case is run from the same seed
+//on one thread and then on several, and every tick's counts and transmissions and the final state of every agent have to match
+//to the bit. Exits with 1 if anything differs, so it can be run as a test.
+
+//Allows output messages
+#include <iostream>
+
+//Command line parsing
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//Circle motion, collision and infection
+#include "Simulation.h"
+
+using namespace std;
+
+//Everything a run produces that could show a difference between thread counts
+struct RunRecord
+{
+	vector<int> counts;
+	vector<Transmission> transmissions;
+
+	//The final state of every agent, in order of id so that how the agents are ordered in memory doesn't matter
+	vector<double> x;
+	vector<double> y;
+	vector<double> vx;
+	vector<double> vy;
+	vector<unsigned char> state;
+};
+
+struct DeterminismCase
+{
+	int agents;
+	double radius;
+	float sim_speed;
+	int ticks;
+};
+
+RunRecord runCase(const DeterminismCase &test, int threads, unsigned long long seed);
+string compareRuns(const RunRecord &single, const RunRecord &multiple);
+void printUsage();
+
+int main(int argc, char **argv)
+{
+	int threads = 4;
+	unsigned long long seed = 1;
+
+	//Read the parameters from the command line
+	for (int arg = 1;arg < argc;arg++) {
+		bool has_value = arg + 1 < argc;
+
+		if (strcmp(argv[arg], "--threads") == 0 && has_value) {
+			threads = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--seed") == 0 && has_value) {
+			seed = strtoull(argv[++arg], NULL, 10);
+		}
+		else {
+			printUsage();
+			return strcmp(argv[arg], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (threads < 2) {
+		cout << "The check needs at least 2 threads to compare against 1" << endl;
+		return 1;
+	}
+
+	//Every case is big enough to be split across the pool. The fast one is split into substeps, and the last is big enough to be
+	//put into Morton order every few dozen ticks.
+	DeterminismCase cases[] = {
+		{ 5000, 0.005, 1.0f, 200 },
+		{ 20000, 0.003, 5.0f, 100 },
+		{ 66000, 0.002, 1.0f, 130 }
+	};
+
+	bool matched = true;
+	for (int test = 0;test < sizeof(cases) / sizeof(cases[0]);test++) {
+		RunRecord single = runCase(cases[test], 1, seed);
+		RunRecord multiple = runCase(cases[test], threads, seed);
+		string difference = compareRuns(single, multiple);
+
+		cout << cases[test].agents << " agents, radius " << cases[test].radius << ", speed " << cases[test].sim_speed << ", " << cases[test].ticks << " ticks: ";
+		if (difference.empty()) {
+			cout << "1 and " << threads << " threads match" << endl;
+		}
+		else {
+			cout << "1 and " << threads << " threads differ in " << difference << endl;
+			matched = false;
+		}
+	}
+
+	return matched ? 0 : 1;
+}
+
+//Runs one case from the start on the given number of threads and records everything it produced
+RunRecord runCase(const DeterminismCase &test, int threads, unsigned long long seed)
+{
+	RunRecord record;
+	setSimulationThreads(threads);
+
+	AgentStore circles(test.agents);
+	createCircles(circles, seed, test.radius);
+
+	for (int tick = 0;tick < test.ticks;tick++) {
+		circleMotion(circles, true, 1.0f, 5.0f, test.sim_speed);
+
+		int susceptible;
+		int infected;
+		int recovered;
+		countCompartments(circles, susceptible, infected, recovered);
+		record.counts.push_back(susceptible);
+		record.counts.push_back(infected);
+		record.counts.push_back(recovered);
+		record.transmissions.insert(record.transmissions.end(), circles.transmissions.begin(), circles.transmissions.end());
+	}
+
+	int count = circles.size();
+	record.x.resize(count);
+	record.y.resize(count);
+	record.vx.resize(count);
+	record.vy.resize(count);
+	record.state.resize(count);
+	for (int agent = 0;agent < count;agent++) {
+		unsigned int id = circles.id[agent];
+		record.x[id] = circles.x[agent];
+		record.y[id] = circles.y[agent];
+		record.vx[id] = circles.vx[agent];
+		record.vy[id] = circles.vy[agent];
+		record.state[id] = circles.state[agent];
+	}
+	return record;
+}
+
+//Whether two arrays hold exactly the same bits
+template <class T>
+static bool sameBits(const vector<T> &first, const vector<T> &second)
+{
+	return first.size() == second.size() && (first.empty() || memcmp(first.data(), second.data(), first.size() * sizeof(T)) == 0);
+}
+
+//Says what differs between two runs of the same case, or nothing if they match
+string compareRuns(const RunRecord &single, const RunRecord &multiple)
+{
+	if (single.counts != multiple.counts) {
+		return "the compartment counts";
+	}
+	if (single.transmissions.size() != multiple.transmissions.size()) {
+		return "the number of transmissions";
+	}
+	for (size_t transmission = 0;transmission < single.transmissions.size();transmission++) {
+		const Transmission &first = single.transmissions[transmission];
+		const Transmission &second = multiple.transmissions[transmission];
+		if (first.tick != second.tick || first.infector != second.infector || first.infectee != second.infectee ||
+			memcmp(&first.x, &second.x, sizeof(float)) != 0 || memcmp(&first.y, &second.y, sizeof(float)) != 0) {
+			return "transmission " + to_string(transmission);
+		}
+	}
+	if (!sameBits(single.x, multiple.x) || !sameBits(single.y, multiple.y)) {
+		return "the final positions";
+	}
+	if (!sameBits(single.vx, multiple.vx) || !sameBits(single.vy, multiple.vy)) {
+		return "the final velocities";
+	}
+	if (single.state != multiple.state) {
+		return "the final states";
+	}
+	return "";
+}
+
+void printUsage()
+{
+	cout << "Usage: DeterminismCheck [options]" << endl
+		<< "  --threads N            threads to compare against a single thread (default 4)" << endl
+		<< "  --seed N               random seed (default 1)" << endl;
+}
@@ -0,0 +1,149 @@
+#include "Ensemble.h"
+
+//Rounding quantile ranks
+#include <cmath>
+#include <algorithm>
+
+//Above this many agents, counts are grouped into this many histogram bins instead of one bin per possible count
+#define MAX_HISTOGRAM_BINS 256
+
+//Runs one copy of the model to the tick limit or until nobody is infected. The trajectory gets the S, I and R counts for the
+//start and for every tick after it, one after another.
+void runReplica(const ModelParameters &parameters, unsigned long long seed, vector<int> &trajectory)
+{
+	//Kept between replicas on the same thread so the arrays don't have to be allocated every time
+	static thread_local AgentStore circles;
+
+	int counts[COMPARTMENT_COUNT];
+
+	circles.resize(parameters.agents);
+	createCircles(circles, seed, parameters.radius);
+
+	trajectory.clear();
+	countCompartments(circles, counts[COMPARTMENT_SUSCEPTIBLE], counts[COMPARTMENT_INFECTED], counts[COMPARTMENT_RECOVERED]);
+	trajectory.insert(trajectory.end(), counts, counts + COMPARTMENT_COUNT);
+
+	for (int tick = 0;tick < parameters.max_ticks && counts[COMPARTMENT_INFECTED] > 0;tick++) {
+		circleMotion(circles, parameters.immunity, parameters.infection_chance, parameters.average_recovery, parameters.sim_speed);
+
+		countCompartments(circles, counts[COMPARTMENT_SUSCEPTIBLE], counts[COMPARTMENT_INFECTED], counts[COMPARTMENT_RECOVERED]);
+		trajectory.insert(trajectory.end(), counts, counts + COMPARTMENT_COUNT);
+	}
+}
+
+Ensemble::Ensemble(const ModelParameters &parameters, int replicas, unsigned long long first_seed)
+{
+	this->parameters = parameters;
+	this->replicas = replicas;
+	this->first_seed = first_seed;
+
+	bin_width = (parameters.agents + MAX_HISTOGRAM_BINS) / MAX_HISTOGRAM_BINS;
+	bins = parameters.agents / bin_width + 1;
+	ticks = 1;
+
+	//Only the starting counts to begin with. The arrays grow as replicas run for longer, since most outbreaks die out long before
+	//the tick limit.
+	histogram.assign((size_t)COMPARTMENT_COUNT * bins, 0);
+	totals.assign(COMPARTMENT_COUNT, 0);
+	final_histogram.assign((size_t)COMPARTMENT_COUNT * bins, 0);
+	final_totals.assign(COMPARTMENT_COUNT, 0);
+	total_duration = 0;
+	total_peak = 0;
+}
+
+//Runs every replica across the pool. Replica r uses seed first_seed + r.
+void Ensemble::run(ThreadPool &pool)
+{
+	pool.run(replicas, [&](int replica) {
+		static thread_local vector<int> trajectory;
+		runReplica(parameters, first_seed + replica, trajectory);
+		addReplica(trajectory);
+	});
+}
+
+//Adds a finished replica into the histograms. Once the infection dies out nothing changes any more, so the last counts are
+//carried on to the end of the longest replica, which keeps every tick's histogram made up of the same number of replicas.
+void Ensemble::addReplica(const vector<int> &trajectory)
+{
+	int length = (int)trajectory.size() / COMPARTMENT_COUNT;
+	int peak = 0;
+	for (int tick = 0;tick < length;tick++) {
+		peak = max(peak, trajectory[tick * COMPARTMENT_COUNT + COMPARTMENT_INFECTED]);
+	}
+
+	unique_lock<mutex> guard(lock);
+
+	//A replica longer than any before it adds ticks, where every earlier replica still has its last counts
+	if (length > ticks) {
+		histogram.resize((size_t)length * COMPARTMENT_COUNT * bins);
+		totals.resize((size_t)length * COMPARTMENT_COUNT);
+		for (int tick = ticks;tick < length;tick++) {
+			copy(final_histogram.begin(), final_histogram.end(), histogram.begin() + (size_t)tick * COMPARTMENT_COUNT * bins);
+			copy(final_totals.begin(), final_totals.end(), totals.begin() + (size_t)tick * COMPARTMENT_COUNT);
+		}
+		ticks = length;
+	}
+
+	for (int tick = 0;tick < ticks;tick++) {
+		const int *counts = &trajectory[min(tick, length - 1) * COMPARTMENT_COUNT];
+		for (int compartment = 0;compartment < COMPARTMENT_COUNT;compartment++) {
+			size_t slot = (size_t)tick * COMPARTMENT_COUNT + compartment;
+			histogram[slot * bins + counts[compartment] / bin_width]++;
+			totals[slot] += counts[compartment];
+		}
+	}
+
+	const int *last = &trajectory[(length - 1) * COMPARTMENT_COUNT];
+	for (int compartment = 0;compartment < COMPARTMENT_COUNT;compartment++) {
+		final_histogram[compartment * bins + last[compartment] / bin_width]++;
+		final_totals[compartment] += last[compartment];
+	}
+
+	total_duration += length - 1;
+	total_peak += peak;
+}
+
+int Ensemble::getReplicas()
+{
+	return replicas;
+}
+
+int Ensemble::getTicks()
+{
+	return ticks;
+}
+
+double Ensemble::mean(Compartment compartment, int tick)
+{
+	return (double)totals[(size_t)tick * COMPARTMENT_COUNT + compartment] / replicas;
+}
+
+//The count that the given fraction of replicas were at or below at this tick. When several counts share a bin, this is the
+//lowest count in the bin.
+int Ensemble::quantile(Compartment compartment, int tick, double fraction)
+{
+	const unsigned int *bin_counts = &histogram[((size_t)tick * COMPARTMENT_COUNT + compartment) * bins];
+
+	//Rank of the replica we're after, counting from one
+	long long rank = max(1LL, (long long)ceil(fraction * replicas));
+	long long seen = 0;
+	for (int bin = 0;bin < bins;bin++) {
+		seen += bin_counts[bin];
+		if (seen >= rank) {
+			return bin * bin_width;
+		}
+	}
+	return (bins - 1) * bin_width;
+}
+
+//Average number of ticks before nobody was infected any more, counting replicas that hit the tick limit at the limit
+double Ensemble::meanDuration()
+{
+	return (double)total_duration / replicas;
+}
+
+//Average of the most circles infected at once
+double Ensemble::meanPeak()
+{
+	return (double)total_peak / replicas;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include "Simulation.h"
+#include "ThreadPool.h"
+using namespace std;
+
+//Which count a band or a trajectory entry is for
+enum Compartment
+{
+	COMPARTMENT_SUSCEPTIBLE = 0,
+	COMPARTMENT_INFECTED = 1,
+	COMPARTMENT_RECOVERED = 2,
+	COMPARTMENT_COUNT = 3
+};
+
+void runReplica(const ModelParameters &parameters, unsigned long long seed, vector<int> &trajectory);
+
+//Runs many copies (replicas) of the same model, each with its own seed, and keeps a summary of how the S/I/R counts spread out
+//over time. Every replica is added into a histogram of the counts for each tick as soon as it finishes, so memory depends on
+//how many ticks the longest replica ran for and not on the number of replicas. Adding counts up doesn't depend on the order
+//replicas finish in, so the result is the same for any number of threads.
+//
+//Each replica runs on a single thread, so the simulation's own pool should be set to one thread (setSimulationThreads(1))
+//before calling run().
+class Ensemble
+{
+	ModelParameters parameters;
+	int replicas;
+	unsigned long long first_seed;
+
+	//How many counts share a histogram bin. One for small populations, so the quantiles are exact.
+	int bin_width;
+	int bins;
+
+	//Ticks actually reached by the longest replica, plus one for the starting counts
+	int ticks;
+
+	//histogram[(tick * COMPARTMENT_COUNT + compartment) * bins + bin] is how many replicas had a count in that bin at that tick
+	vector<unsigned int> histogram;
+	//Sum of the counts over every replica, for the means
+	vector<long long> totals;
+	//The same for the last counts of every replica added so far, which is what each of them has from then on. These fill in the
+	//ticks a longer replica adds.
+	vector<unsigned int> final_histogram;
+	vector<long long> final_totals;
+	//How many ticks each replica ran for before the infection died out, and the most infected at once
+	long long total_duration;
+	long long total_peak;
+	mutex lock;
+
+	void addReplica(const vector<int> &trajectory);
+
+public:
+	Ensemble(const ModelParameters &parameters, int replicas, unsigned long long first_seed);
+	void run(ThreadPool &pool);
+	int getReplicas();
+	int getTicks();
+	double mean(Compartment compartment, int tick);
+	int quantile(Compartment compartment, int tick, double fraction);
+	double meanDuration();
+	double meanPeak();
+};
@@ -0,0 +1,157 @@
+//Runs many replicas of the contact model with different seeds and writes out how the S/I/R counts spread across them. A single
+//run is only one random sample of how an outbreak might go, so this is what to use for any actual analysis. The replicas are
+//shared out across a pool of threads, one replica per thread at a time.
+
+//Allows output messages
+#include <iostream>
+#include <fstream>
+
+//Command line parsing
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//Timing of the run
+#include <chrono>
+#include <ctime>
+
+//Replicas and their summary
+#include "Ensemble.h"
+
+using namespace std;
+
+void printUsage();
+
+int main(int argc, char **argv)
+{
+	ModelParameters parameters;
+	int replicas = 1000;
+	unsigned long long seed = (unsigned long long)time(NULL);
+	int threads = 0;
+	int every = 1;
+	string output_path = "ensemble.csv";
+
+	//Read the parameters from the command line
+	for (int arg = 1;arg < argc;arg++) {
+		//Every option except the flags takes a value after it
+		bool has_value = arg + 1 < argc;
+
+		if (strcmp(argv[arg], "--agents") == 0 && has_value) {
+			parameters.agents = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--ticks") == 0 && has_value) {
+			parameters.max_ticks = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--radius") == 0 && has_value) {
+			parameters.radius = atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--speed") == 0 && has_value) {
+			parameters.sim_speed = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--infection-chance") == 0 && has_value) {
+			parameters.infection_chance = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--recovery") == 0 && has_value) {
+			parameters.average_recovery = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--replicas") == 0 && has_value) {
+			replicas = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--seed") == 0 && has_value) {
+			seed = strtoull(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--threads") == 0 && has_value) {
+			threads = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--every") == 0 && has_value) {
+			every = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--output") == 0 && has_value) {
+			output_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--no-immunity") == 0) {
+			parameters.immunity = false;
+		}
+		else {
+			printUsage();
+			return strcmp(argv[arg], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (parameters.agents < 1 || parameters.max_ticks < 0 || parameters.radius <= 0.0 || replicas < 1 || every < 1) {
+		cout << "The number of agents, replicas, the radius and the output interval must be positive" << endl;
+		return 1;
+	}
+
+	//The replicas are what get spread across the threads, so each one runs its own simulation on a single thread
+	setSimulationThreads(1);
+	ThreadPool pool(threads);
+
+	Ensemble ensemble(parameters, replicas, seed);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	ensemble.run(pool);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	ofstream output(output_path.c_str());
+	if (!output) {
+		cout << "Failed to open " << output_path << endl;
+		return 1;
+	}
+
+	//The mean and the 5%, 25%, 50%, 75% and 95% quantiles of each count at every tick
+	const char *names[COMPARTMENT_COUNT] = { "susceptible", "infected", "recovered" };
+	double fractions[] = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+	const char *fraction_names[] = { "q05", "q25", "median", "q75", "q95" };
+	int quantiles = sizeof(fractions) / sizeof(fractions[0]);
+
+	output << "tick";
+	for (int compartment = 0;compartment < COMPARTMENT_COUNT;compartment++) {
+		output << "," << names[compartment] << "_mean";
+		for (int fraction = 0;fraction < quantiles;fraction++) {
+			output << "," << names[compartment] << "_" << fraction_names[fraction];
+		}
+	}
+	output << endl;
+
+	for (int tick = 0;tick < ensemble.getTicks();tick++) {
+		//Always include the last tick so the final sizes are in the table
+		if (tick % every != 0 && tick != ensemble.getTicks() - 1) {
+			continue;
+		}
+		output << tick;
+		for (int compartment = 0;compartment < COMPARTMENT_COUNT;compartment++) {
+			output << "," << ensemble.mean((Compartment)compartment, tick);
+			for (int fraction = 0;fraction < quantiles;fraction++) {
+				output << "," << ensemble.quantile((Compartment)compartment, tick, fractions[fraction]);
+			}
+		}
+		output << endl;
+	}
+
+	int last = ensemble.getTicks() - 1;
+	cout << "Replicas: " << replicas << " in " << seconds << " s (" << (seconds > 0.0 ? replicas / seconds : 0.0) << " replicas per second)" << endl
+		<< "Mean outbreak length: " << ensemble.meanDuration() << " ticks" << endl
+		<< "Mean peak infected: " << ensemble.meanPeak() << endl
+		<< "Final recovered: mean " << ensemble.mean(COMPARTMENT_RECOVERED, last) << ", 5% " << ensemble.quantile(COMPARTMENT_RECOVERED, last, 0.05)
+		<< ", median " << ensemble.quantile(COMPARTMENT_RECOVERED, last, 0.5) << ", 95% " << ensemble.quantile(COMPARTMENT_RECOVERED, last, 0.95) << endl;
+
+	return 0;
+}
+
+void printUsage()
+{
+	cout << "Usage: EnsembleRunner [options]" << endl
+		<< "  --replicas N           number of replicas to run (default 1000)" << endl
+		<< "  --agents N             number of circles/people in each replica (default 30)" << endl
+		<< "  --ticks N              maximum number of ticks per replica (default 10000)" << endl
+		<< "  --radius R             circle radius, the screen is 2 units wide (default 0.05)" << endl
+		<< "  --speed S              simulation speed multiplier (default 1)" << endl
+		<< "  --infection-chance P   chance of infection per contact (default 1.0)" << endl
+		<< "  --recovery T           average recovery time (default 5.0)" << endl
+		<< "  --no-immunity          allow recovered circles to be reinfected" << endl
+		<< "  --seed N               seed of the first replica, the rest count up from it (default: current time)" << endl
+		<< "  --threads N            worker threads, 0 for one per hardware thread (default 0)" << endl
+		<< "  --every N              only write every Nth tick to the table (default 1)" << endl
+		<< "  --output FILE          where to write the table of means and quantiles (default ensemble.csv)" << endl;
+}
@@ -0,0 +1,179 @@
+#include "EpidemicCurve.h"
+
+#include <cmath>
+
+void largestTriangleThreeBuckets(const float *x, const float *y, int count, int threshold, vector<int> &chosen)
+{
+	chosen.clear();
+
+	//Nothing to reduce
+	if (threshold >= count || threshold < 3) {
+		for (int point = 0;point < count;point++) {
+			chosen.push_back(point);
+		}
+		return;
+	}
+
+	//The first and last points are always kept, and the rest are split into threshold - 2 buckets. One point is picked from each
+	//bucket: the one making the biggest triangle with the point picked before it and the average of the next bucket.
+	double bucket_size = (double)(count - 2) / (threshold - 2);
+	int previous = 0;
+	chosen.push_back(0);
+
+	for (int bucket = 0;bucket < threshold - 2;bucket++) {
+		int start = (int)(bucket * bucket_size) + 1;
+		int end = (int)((bucket + 1) * bucket_size) + 1;
+
+		int next_start = end;
+		int next_end = bucket == threshold - 3 ? count : (int)((bucket + 2) * bucket_size) + 1;
+		double average_x = 0.0;
+		double average_y = 0.0;
+		for (int point = next_start;point < next_end;point++) {
+			average_x += x[point];
+			average_y += y[point];
+		}
+		average_x /= next_end - next_start;
+		average_y /= next_end - next_start;
+
+		double largest_area = -1.0;
+		int best = start;
+		for (int point = start;point < end;point++) {
+			//Twice the area, which picks the same point
+			double area = fabs((x[previous] - average_x) * (y[point] - y[previous]) - (x[previous] - x[point]) * (average_y - y[previous]));
+			if (area > largest_area) {
+				largest_area = area;
+				best = point;
+			}
+		}
+
+		chosen.push_back(best);
+		previous = best;
+	}
+
+	chosen.push_back(count - 1);
+}
+
+EpidemicCurve::EpidemicCurve()
+{
+	ticks.reserve(CURVE_CAPACITY);
+	for (int series = 0;series < CURVE_SERIES;series++) {
+		values[series].reserve(CURVE_CAPACITY);
+	}
+	clear();
+}
+
+void EpidemicCurve::clear()
+{
+	ticks.clear();
+	for (int series = 0;series < CURVE_SERIES;series++) {
+		values[series].clear();
+	}
+	stride = 1;
+	pending_ticks = 0;
+	empty = true;
+}
+
+//Adds the counts after a tick. Going back to an earlier tick means the simulation started over, so the old history is dropped.
+void EpidemicCurve::add(unsigned int tick, int susceptible, int infected, int recovered)
+{
+	if (!empty && tick < latest[0]) {
+		clear();
+	}
+
+	float row[CURVE_SERIES + 1] = { (float)tick, (float)susceptible, (float)infected, (float)recovered };
+	for (int column = 0;column < CURVE_SERIES + 1;column++) {
+		latest[column] = row[column];
+	}
+
+	//The very first row is always kept, so the plot starts where the run did
+	if (empty) {
+		empty = false;
+		keep(row);
+		return;
+	}
+
+	//Of the ticks this row stands for, keep whichever infected count strays furthest from the last row
+	float kept_infected = values[CURVE_INFECTED].back();
+	if (pending_ticks == 0 || fabs(row[1 + CURVE_INFECTED] - kept_infected) > fabs(pending[1 + CURVE_INFECTED] - kept_infected)) {
+		for (int column = 0;column < CURVE_SERIES + 1;column++) {
+			pending[column] = row[column];
+		}
+	}
+	pending_ticks++;
+
+	if (pending_ticks == stride) {
+		keep(pending);
+		pending_ticks = 0;
+	}
+}
+
+void EpidemicCurve::keep(const float row[CURVE_SERIES + 1])
+{
+	if (ticks.size() == CURVE_CAPACITY) {
+		compact();
+	}
+	ticks.push_back(row[0]);
+	for (int series = 0;series < CURVE_SERIES;series++) {
+		values[series].push_back(row[1 + series]);
+	}
+}
+
+//Halves the rows, keeping the ones that best hold the shape of the infected curve, and from now on keeps half as many ticks
+void EpidemicCurve::compact()
+{
+	largestTriangleThreeBuckets(ticks.data(), values[CURVE_INFECTED].data(), (int)ticks.size(), CURVE_CAPACITY / 2, chosen);
+
+	//The chosen rows are in order and never ahead of where they're copied to, so this can be done in place
+	for (int row = 0;row < chosen.size();row++) {
+		ticks[row] = ticks[chosen[row]];
+		for (int series = 0;series < CURVE_SERIES;series++) {
+			values[series][row] = values[series][chosen[row]];
+		}
+	}
+	ticks.resize(chosen.size());
+	for (int series = 0;series < CURVE_SERIES;series++) {
+		values[series].resize(chosen.size());
+	}
+
+	stride *= 2;
+}
+
+void EpidemicCurve::downsample(CurveSeries series, int points, vector<float> &point_ticks, vector<float> &point_values) const
+{
+	point_ticks.clear();
+	point_values.clear();
+	if (empty) {
+		return;
+	}
+
+	//Run the reducer over the kept rows followed by the latest tick, so the line reaches right up to now
+	point_ticks.assign(ticks.begin(), ticks.end());
+	point_values.assign(values[series].begin(), values[series].end());
+	if (latest[0] > ticks.back()) {
+		point_ticks.push_back(latest[0]);
+		point_values.push_back(latest[1 + series]);
+	}
+
+	largestTriangleThreeBuckets(point_ticks.data(), point_values.data(), (int)point_ticks.size(), points, chosen);
+	for (int point = 0;point < chosen.size();point++) {
+		point_ticks[point] = point_ticks[chosen[point]];
+		point_values[point] = point_values[chosen[point]];
+	}
+	point_ticks.resize(chosen.size());
+	point_values.resize(chosen.size());
+}
+
+float EpidemicCurve::firstTick() const
+{
+	return empty ? 0.0f : ticks.front();
+}
+
+float EpidemicCurve::lastTick() const
+{
+	return empty ? 0.0f : latest[0];
+}
+
+float EpidemicCurve::population() const
+{
+	return empty ? 0.0f : latest[1 + CURVE_SUSCEPTIBLE] + latest[1 + CURVE_INFECTED] + latest[1 + CURVE_RECOVERED];
+}
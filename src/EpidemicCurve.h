@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+using namespace std;
+
+//The susceptible, infected and recovered counts over the whole of a run, kept small enough to draw every frame.
+//
+//The history lives in a fixed number of rows. Once they are all used, the largest-triangle-three-buckets reducer picks out the half
+//of the rows that best keep the shape of the infected curve, and from then on only one tick in twice as many is kept. For the ticks
+//in between, the one that strays furthest from the last kept infected count is the one kept, so short spikes aren't skipped over.
+//However long the run goes on for, the history never has more than CURVE_CAPACITY rows, and drawing it costs the same every frame.
+
+#define CURVE_CAPACITY 2048
+
+//Picks threshold of the count points that best keep the shape of the line through them, always including the first and last.
+//The x values have to be in increasing order.
+void largestTriangleThreeBuckets(const float *x, const float *y, int count, int threshold, vector<int> &chosen);
+
+enum CurveSeries
+{
+	CURVE_SUSCEPTIBLE,
+	CURVE_INFECTED,
+	CURVE_RECOVERED,
+	CURVE_SERIES
+};
+
+class EpidemicCurve
+{
+	//One row per kept tick
+	vector<float> ticks;
+	vector<float> values[CURVE_SERIES];
+
+	//How many ticks each kept row stands for now, and the best candidate so far for the next one
+	int stride;
+	int pending_ticks;
+	float pending[CURVE_SERIES + 1];
+	float latest[CURVE_SERIES + 1];
+	bool empty;
+
+	void keep(const float row[CURVE_SERIES + 1]);
+	void compact();
+
+	//Scratch space reused by every reduction. Drawing only ever reads the curve, so it doesn't count as part of its value.
+	mutable vector<int> chosen;
+
+public:
+	EpidemicCurve();
+	void clear();
+	void add(unsigned int tick, int susceptible, int infected, int recovered);
+
+	//Reduces one of the counts to at most the given number of points, for drawing a plot that many pixels wide
+	void downsample(CurveSeries series, int points, vector<float> &point_ticks, vector<float> &point_values) const;
+
+	//The span of ticks covered and the total population at the last tick, for scaling the plot
+	float firstTick() const;
+	float lastTick() const;
+	float population() const;
+};
@@ -0,0 +1,470 @@
+#include "EventSimulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+//Gives random number generation
+#include "Random.h"
+
+//Timers for each tick
+#include "Profiler.h"
+
+//How far two circles can be inside each other, as a fraction of the square of their radii added together, and still count as
+//just touching
+#define OVERLAP_TOLERANCE 1e-9
+
+//How big the queue of events can get, per circle, before the ones that are out of date are swept out
+#define EVENTS_PER_CIRCLE 8
+
+//Which way a circle leaves its cell. EVENT_CELL events keep this in other.
+enum CellDirection
+{
+	CELL_RIGHT,
+	CELL_LEFT,
+	CELL_UP,
+	CELL_DOWN
+};
+
+bool LaterEvent::operator()(const SimulationEvent &first, const SimulationEvent &second) const
+{
+	if (first.time != second.time) {
+		return first.time > second.time;
+	}
+	if (first.type != second.type) {
+		return first.type > second.type;
+	}
+	if (first.circle != second.circle) {
+		return first.circle > second.circle;
+	}
+	return first.other > second.other;
+}
+
+EventSimulation::EventSimulation(AgentStore &circles, const ModelParameters &parameters) : circles(circles)
+{
+	immunity = parameters.immunity;
+	infection_chance = parameters.infection_chance;
+	step = parameters.sim_speed * CIRCLE_SPEED;
+	recovery_chance = 1 / (parameters.average_recovery * TICKS_PER_SECOND) * parameters.sim_speed;
+
+	int count = circles.size();
+	now = circles.tick;
+	updated.assign(count, now);
+	changes.assign(count, 0);
+
+	//Cells at least one diameter wide, so a circle can only touch circles in its own cell and the eight around it. There's no skin,
+	//and the cap of one cell per circle is lower than SpatialGrid's, since every cell crossing is an event of its own.
+	double max_radius = 0.0;
+	for (int circle = 0;circle < count;circle++) {
+		max_radius = max(max_radius, circles.radius[circle]);
+	}
+	cells_per_side = max(1, int(floor(2.0 / max(2.0 * max_radius, 1e-6))));
+	cells_per_side = min(cells_per_side, max(1, int(ceil(sqrt((double)count)))));
+	cell_size = 2.0 / cells_per_side;
+
+	cell_circles.assign(cells_per_side * cells_per_side, vector<int>());
+	cell_x.resize(count);
+	cell_y.resize(count);
+	for (int circle = 0;circle < count;circle++) {
+		cell_x[circle] = max(0, min(cells_per_side - 1, int(floor((circles.x[circle] + 1.0) / cell_size))));
+		cell_y[circle] = max(0, min(cells_per_side - 1, int(floor((circles.y[circle] + 1.0) / cell_size))));
+		cell_circles[cell_y[circle] * cells_per_side + cell_x[circle]].push_back(circle);
+	}
+
+	//Predict everything from scratch. Each pair only needs predicting once.
+	for (int circle = 0;circle < count;circle++) {
+		predictWalls(circle);
+		predictCell(circle);
+		for (int row = max(0, cell_y[circle] - 1);row <= min(cells_per_side - 1, cell_y[circle] + 1);row++) {
+			for (int column = max(0, cell_x[circle] - 1);column <= min(cells_per_side - 1, cell_x[circle] + 1);column++) {
+				vector<int> &others = cell_circles[row * cells_per_side + column];
+				for (int other = 0;other < others.size();other++) {
+					if (others[other] > circle) {
+						predictCollision(circle, others[other]);
+					}
+				}
+			}
+		}
+		if (circles.state[circle] & INFECTED) {
+			scheduleRecovery(circle);
+		}
+	}
+}
+
+//Moves a circle's position in the store up to the current time
+void EventSimulation::advance(int circle)
+{
+	positionAt(circle, now, circles.x[circle], circles.y[circle]);
+	updated[circle] = now;
+}
+
+void EventSimulation::positionAt(int circle, double time, double &x, double &y)
+{
+	double elapsed = (time - updated[circle]) * step;
+	x = circles.x[circle] + circles.vx[circle] * elapsed;
+	y = circles.y[circle] + circles.vy[circle] * elapsed;
+}
+
+void EventSimulation::push(double time, EventType type, int circle, int other)
+{
+	SimulationEvent event;
+	event.time = max(time, now);
+	event.type = type;
+	event.circle = circle;
+	event.other = other;
+	event.changes = changes[circle];
+	event.other_changes = type == EVENT_COLLISION ? changes[other] : 0;
+	events.push_back(event);
+	push_heap(events.begin(), events.end(), LaterEvent());
+}
+
+//Every change of course leaves behind predictions that will never happen, and the ones for far in the future sit in the queue
+//for a long time before they come up and get skipped. Once they build up, sweep them all out at once, so the queue stays a few
+//events per circle and pushing and popping stay cheap.
+void EventSimulation::prune()
+{
+	if (events.size() < EVENTS_PER_CIRCLE * (circles.size() + 1)) {
+		return;
+	}
+	events.erase(remove_if(events.begin(), events.end(), [&](const SimulationEvent &event) { return !isCurrent(event); }), events.end());
+	make_heap(events.begin(), events.end(), LaterEvent());
+}
+
+//Predicts everything that could happen next to a circle that has just changed course
+void EventSimulation::predict(int circle)
+{
+	predictWalls(circle);
+	predictCell(circle);
+	predictCollisions(circle, cell_x[circle] - 1, cell_x[circle] + 1, cell_y[circle] - 1, cell_y[circle] + 1);
+}
+
+//Works out when a circle will reach the wall it's heading towards on each axis
+void EventSimulation::predictWalls(int circle)
+{
+	double x;
+	double y;
+	positionAt(circle, now, x, y);
+	double radius = circles.radius[circle];
+	double velocity_x = circles.vx[circle] * step;
+	double velocity_y = circles.vy[circle] * step;
+
+	if (velocity_x > 0.0) {
+		push(now + (1.0 - radius - x) / velocity_x, EVENT_WALL_X, circle, 0);
+	}
+	else if (velocity_x < 0.0) {
+		push(now + (-1.0 + radius - x) / velocity_x, EVENT_WALL_X, circle, 0);
+	}
+	if (velocity_y > 0.0) {
+		push(now + (1.0 - radius - y) / velocity_y, EVENT_WALL_Y, circle, 0);
+	}
+	else if (velocity_y < 0.0) {
+		push(now + (-1.0 + radius - y) / velocity_y, EVENT_WALL_Y, circle, 0);
+	}
+}
+
+//Predicts collisions with every circle in the given block of cells
+void EventSimulation::predictCollisions(int circle, int first_x, int last_x, int first_y, int last_y)
+{
+	for (int row = max(0, first_y);row <= min(cells_per_side - 1, last_y);row++) {
+		for (int column = max(0, first_x);column <= min(cells_per_side - 1, last_x);column++) {
+			vector<int> &others = cell_circles[row * cells_per_side + column];
+			for (int other = 0;other < others.size();other++) {
+				if (others[other] != circle) {
+					predictCollision(circle, others[other]);
+				}
+			}
+		}
+	}
+}
+
+//Works out when two circles moving in straight lines will first touch, if they ever do. Circles that are touching to within
+//rounding error and still heading into each other collide straight away. Circles that are already well inside each other, which
+//only happens when they were placed that way, are left to drift apart: bouncing them would only turn them round inside the
+//other circle, or into a third one, over and over without time moving on.
+void EventSimulation::predictCollision(int circle, int other)
+{
+	double x;
+	double y;
+	double other_x;
+	double other_y;
+	positionAt(circle, now, x, y);
+	positionAt(other, now, other_x, other_y);
+
+	double distance_x = x - other_x;
+	double distance_y = y - other_y;
+	double velocity_x = (circles.vx[circle] - circles.vx[other]) * step;
+	double velocity_y = (circles.vy[circle] - circles.vy[other]) * step;
+
+	//Moving apart, or not moving relative to each other at all
+	double closing = distance_x * velocity_x + distance_y * velocity_y;
+	if (closing >= 0.0) {
+		return;
+	}
+
+	double reach = circles.radius[circle] + circles.radius[other];
+	double gap = distance_x * distance_x + distance_y * distance_y - reach * reach;
+	double speed = velocity_x * velocity_x + velocity_y * velocity_y;
+
+	double time;
+	if (gap < -OVERLAP_TOLERANCE * reach * reach) {
+		return;
+	}
+	else if (gap <= 0.0) {
+		time = now;
+	}
+	else {
+		double discriminant = closing * closing - speed * gap;
+		if (discriminant < 0.0) {
+			return;
+		}
+		time = now - (closing + sqrt(discriminant)) / speed;
+	}
+
+	//Collisions are kept with the lower index first, the same way round circleCollision finds them
+	push(time, EVENT_COLLISION, min(circle, other), max(circle, other));
+}
+
+//Works out when a circle's center will cross into the next cell over. There's nothing past the edge cells but the walls.
+void EventSimulation::predictCell(int circle)
+{
+	double x;
+	double y;
+	positionAt(circle, now, x, y);
+	double velocity_x = circles.vx[circle] * step;
+	double velocity_y = circles.vy[circle] * step;
+
+	double time = HUGE_VAL;
+	int direction = CELL_RIGHT;
+
+	if (velocity_x > 0.0 && cell_x[circle] < cells_per_side - 1) {
+		time = (-1.0 + (cell_x[circle] + 1) * cell_size - x) / velocity_x;
+		direction = CELL_RIGHT;
+	}
+	else if (velocity_x < 0.0 && cell_x[circle] > 0) {
+		time = (-1.0 + cell_x[circle] * cell_size - x) / velocity_x;
+		direction = CELL_LEFT;
+	}
+
+	if (velocity_y > 0.0 && cell_y[circle] < cells_per_side - 1) {
+		double time_y = (-1.0 + (cell_y[circle] + 1) * cell_size - y) / velocity_y;
+		if (time_y < time) {
+			time = time_y;
+			direction = CELL_UP;
+		}
+	}
+	else if (velocity_y < 0.0 && cell_y[circle] > 0) {
+		double time_y = (-1.0 + cell_y[circle] * cell_size - y) / velocity_y;
+		if (time_y < time) {
+			time = time_y;
+			direction = CELL_DOWN;
+		}
+	}
+
+	if (time != HUGE_VAL) {
+		push(now + time, EVENT_CELL, circle, direction);
+	}
+}
+
+//Picks when a newly infected circle will recover. Recovering has the same chance every tick, so the wait is exponential, with
+//the rate set so that the chance of still being infected after any whole number of ticks is the same as in circleCollision.
+void EventSimulation::scheduleRecovery(int circle)
+{
+	if (!(recovery_chance > 0.0)) {
+		return;
+	}
+
+	double wait = 0.0;
+	if (recovery_chance < 1.0) {
+		double random = randomUniform(circles.seed, circles.tick, circles.id[circle], 0, RANDOM_RECOVERY);
+		wait = log(1.0 - random) / log(1.0 - recovery_chance);
+	}
+	push(now + wait, EVENT_RECOVERY, circle, 0);
+}
+
+//Whether nothing has happened to the circles since the event was predicted that would stop it from happening
+bool EventSimulation::isCurrent(const SimulationEvent &event)
+{
+	if (event.type == EVENT_RECOVERY) {
+		return true;
+	}
+	if (event.changes != changes[event.circle]) {
+		return false;
+	}
+	return event.type != EVENT_COLLISION || event.other_changes == changes[event.other];
+}
+
+void EventSimulation::runTick()
+{
+	PROFILE_SCOPE("Events");
+
+	circles.new_infections = 0;
+	circles.new_recoveries = 0;
+	circles.transmissions.clear();
+
+	double end = (double)circles.tick + 1.0;
+
+	prune();
+
+	while (!events.empty() && events.front().time < end) {
+		SimulationEvent event = events.front();
+		pop_heap(events.begin(), events.end(), LaterEvent());
+		events.pop_back();
+		if (!isCurrent(event)) {
+			continue;
+		}
+
+		if (event.time > now) {
+			now = event.time;
+			collided_now.clear();
+		}
+		switch (event.type) {
+		case EVENT_COLLISION:
+			//A circle caught touching several others at once, which circles left touching by createCircles can be, would otherwise
+			//be turned from one into the next forever without time moving on. Each pair only gets to bounce once at any one moment.
+			{
+				unsigned long long pair = ((unsigned long long)event.circle << 32) | (unsigned int)event.other;
+				if (find(collided_now.begin(), collided_now.end(), pair) == collided_now.end()) {
+					collided_now.push_back(pair);
+					collide(event.circle, event.other);
+				}
+			}
+			break;
+		case EVENT_WALL_X:
+		case EVENT_WALL_Y:
+			bounce(event.circle, event.type);
+			break;
+		case EVENT_CELL:
+			changeCell(event.circle, event.other);
+			break;
+		case EVENT_RECOVERY:
+			recover(event.circle);
+			break;
+		}
+	}
+
+	now = end;
+	circles.tick++;
+}
+
+//Two circles have just touched. They bounce off each other the same way as in circleCollision, and may pass on the infection.
+void EventSimulation::collide(int circle, int other)
+{
+	advance(circle);
+	advance(other);
+
+	double distance[2];
+	distance[0] = circles.x[circle] - circles.x[other];
+	distance[1] = circles.y[circle] - circles.y[other];
+	double magnitude = sqrt(distance[0] * distance[0] + distance[1] * distance[1]);
+
+	//Right on top of each other there's no way to tell which way to bounce, but they still touched
+	if (magnitude > 0.0) {
+		distance[0] = distance[0] / magnitude;
+		distance[1] = distance[1] / magnitude;
+
+		//Reflect both velocities in the plane where they touch
+		double dot = circles.vx[circle] * distance[0] + circles.vy[circle] * distance[1];
+		circles.vx[circle] = circles.vx[circle] - 2 * dot * distance[0];
+		circles.vy[circle] = circles.vy[circle] - 2 * dot * distance[1];
+
+		dot = circles.vx[other] * distance[0] + circles.vy[other] * distance[1];
+		circles.vx[other] = circles.vx[other] - 2 * dot * distance[0];
+		circles.vy[other] = circles.vy[other] - 2 * dot * distance[1];
+	}
+
+	changes[circle]++;
+	changes[other]++;
+
+	//Check for infection transmission. This can only happen when exactly one of the two circles is infected. The random number is
+	//the one circleCollision would use for this pair on this tick.
+	unsigned char infectable = immunity ? SUSCEPTIBLE : (SUSCEPTIBLE | RECOVERED);
+	if ((circles.state[circle] ^ circles.state[other]) & INFECTED) {
+		unsigned int circle_id = circles.id[circle];
+		unsigned int other_id = circles.id[other];
+		if (randomUniform(circles.seed, circles.tick, min(circle_id, other_id), max(circle_id, other_id), RANDOM_INFECTION) < infection_chance) {
+			int target = (circles.state[circle] & INFECTED) ? other : circle;
+			if (circles.state[target] & infectable) {
+				if (circles.state[target] & SUSCEPTIBLE) {
+					circles.susceptible--;
+				}
+				else {
+					circles.recovered--;
+				}
+				circles.infected++;
+				circles.state[target] = INFECTED;
+				circles.new_infections++;
+
+				Transmission transmission;
+				transmission.tick = circles.tick;
+				transmission.infector = target == circle ? other_id : circle_id;
+				transmission.infectee = circles.id[target];
+				transmission.x = (float)((circles.x[circle] + circles.x[other]) / 2);
+				transmission.y = (float)((circles.y[circle] + circles.y[other]) / 2);
+				circles.transmissions.push_back(transmission);
+
+				scheduleRecovery(target);
+			}
+		}
+	}
+
+	predict(circle);
+	predict(other);
+}
+
+//A circle has reached a wall. It's put exactly on the wall, so rounding can't leave it just short and hitting it again.
+void EventSimulation::bounce(int circle, EventType wall)
+{
+	advance(circle);
+
+	double radius = circles.radius[circle];
+	if (wall == EVENT_WALL_X) {
+		circles.x[circle] = circles.vx[circle] > 0.0 ? 1.0 - radius : -1.0 + radius;
+		circles.vx[circle] = -circles.vx[circle];
+	}
+	else {
+		circles.y[circle] = circles.vy[circle] > 0.0 ? 1.0 - radius : -1.0 + radius;
+		circles.vy[circle] = -circles.vy[circle];
+	}
+
+	changes[circle]++;
+	predict(circle);
+}
+
+//A circle's center has crossed into the next cell. Its course hasn't changed, so everything already predicted for it still
+//stands; it only has to look out for the circles in the row or column of cells that have just come within reach.
+void EventSimulation::changeCell(int circle, int direction)
+{
+	vector<int> &old_cell = cell_circles[cell_y[circle] * cells_per_side + cell_x[circle]];
+	old_cell.erase(find(old_cell.begin(), old_cell.end(), circle));
+
+	switch (direction) {
+	case CELL_RIGHT:
+		cell_x[circle]++;
+		predictCollisions(circle, cell_x[circle] + 1, cell_x[circle] + 1, cell_y[circle] - 1, cell_y[circle] + 1);
+		break;
+	case CELL_LEFT:
+		cell_x[circle]--;
+		predictCollisions(circle, cell_x[circle] - 1, cell_x[circle] - 1, cell_y[circle] - 1, cell_y[circle] + 1);
+		break;
+	case CELL_UP:
+		cell_y[circle]++;
+		predictCollisions(circle, cell_x[circle] - 1, cell_x[circle] + 1, cell_y[circle] + 1, cell_y[circle] + 1);
+		break;
+	case CELL_DOWN:
+		cell_y[circle]--;
+		predictCollisions(circle, cell_x[circle] - 1, cell_x[circle] + 1, cell_y[circle] - 1, cell_y[circle] - 1);
+		break;
+	}
+
+	cell_circles[cell_y[circle] * cells_per_side + cell_x[circle]].push_back(circle);
+	predictCell(circle);
+}
+
+void EventSimulation::recover(int circle)
+{
+	if (circles.state[circle] & INFECTED) {
+		circles.state[circle] = RECOVERED;
+		circles.infected--;
+		circles.recovered++;
+		circles.new_recoveries++;
+	}
+}
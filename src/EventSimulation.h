@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include "Simulation.h"
+using namespace std;
+
+//A second way of running the same model. Between collisions every circle moves in a straight line, so rather than stepping every
+//circle forward every tick, this works out when the next thing will happen and jumps straight to it. The things that can happen
+//are two circles touching, a circle reaching a wall, a circle crossing into another cell of the grid (so it can look out for the
+//circles around its new cell), and a circle recovering. Each is kept in a priority queue by the time it happens.
+//
+//Positions are only brought up to date for the circles an event involves. Every other circle's x and y in the store are where it
+//was at the time of its last event, so the positions can't be saved or drawn from the store. Only the tick, the counts and the
+//states can be relied on. A tick with nothing happening in it costs next to nothing, which is what makes this so much faster
+//when the circles are spread out.
+//
+//The rules match circleMotion: circles bounce off each other and the walls the same way, an infection has one chance per pair
+//per tick, and recovery is as likely over any whole number of ticks. Collisions happen at the exact moment the circles touch
+//instead of at the end of a tick, so runs don't match the ticked ones circle for circle, only on average.
+
+enum EventType
+{
+	EVENT_COLLISION,
+	EVENT_WALL_X,
+	EVENT_WALL_Y,
+	EVENT_CELL,
+	EVENT_RECOVERY
+};
+
+struct SimulationEvent
+{
+	double time;
+	EventType type;
+	int circle;
+	//The other circle in a collision, or which way a circle is leaving its cell
+	int other;
+
+	//How many times each circle had changed course when this was predicted. If either has changed course since, the prediction
+	//is out of date and the event is skipped.
+	unsigned int changes;
+	unsigned int other_changes;
+};
+
+//Puts the earliest event at the top of the queue. Ties are broken on everything else, so the order never depends on the order
+//things happened to be predicted in.
+struct LaterEvent
+{
+	bool operator()(const SimulationEvent &first, const SimulationEvent &second) const;
+};
+
+class EventSimulation
+{
+	AgentStore &circles;
+	bool immunity;
+	float infection_chance;
+
+	//How far a circle with a unit velocity moves in one tick, and the chance of recovering in any one tick
+	double step;
+	double recovery_chance;
+
+	//The time everything has been run up to, in ticks, and the pairs that have already collided at exactly that time
+	double now;
+	vector<unsigned long long> collided_now;
+
+	//The time each circle's position in the store was last brought up to date, and how many times it has changed course
+	vector<double> updated;
+	vector<unsigned int> changes;
+
+	//Which cell of the grid each circle's center is in, and the circles in each cell. The cells are at least one diameter wide,
+	//so a circle can only reach the circles in its own cell or the eight around it before one of them moves to another cell.
+	double cell_size;
+	int cells_per_side;
+	vector<int> cell_x;
+	vector<int> cell_y;
+	vector<vector<int> > cell_circles;
+
+	//A heap with the earliest event at the front
+	vector<SimulationEvent> events;
+
+	void advance(int circle);
+	void positionAt(int circle, double time, double &x, double &y);
+	void push(double time, EventType type, int circle, int other);
+	void prune();
+	void predict(int circle);
+	void predictWalls(int circle);
+	void predictCollisions(int circle, int first_x, int last_x, int first_y, int last_y);
+	void predictCollision(int circle, int other);
+	void predictCell(int circle);
+	void scheduleRecovery(int circle);
+	bool isCurrent(const SimulationEvent &event);
+
+	void collide(int circle, int other);
+	void bounce(int circle, EventType wall);
+	void changeCell(int circle, int direction);
+	void recover(int circle);
+
+public:
+	//Starts from wherever the circles are now, such as straight after createCircles
+	EventSimulation(AgentStore &circles, const ModelParameters &parameters);
+
+	//Runs every event up to the end of the current tick and moves on to the next one. The tick, the counts, and the new infections,
+	//recoveries and transmissions in the store are all kept up to date the same way circleMotion does.
+	void runTick();
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+//Owners for OpenGL objects. Each one creates its object when it's made and deletes it when it goes away, so nothing on the graphics
+//card is leaked. They can be moved but not copied, since two owners of the same object would both try to delete it. All of them
+//have to be made and destroyed while the OpenGL context is current.
+
+class GLBuffer
+{
+	unsigned int handle;
+
+public:
+	GLBuffer() { glGenBuffers(1, &handle); }
+	~GLBuffer() { if (handle != 0) glDeleteBuffers(1, &handle); }
+	GLBuffer(GLBuffer &&other) : handle(other.handle) { other.handle = 0; }
+	GLBuffer &operator=(GLBuffer &&other)
+	{
+		if (this != &other) {
+			if (handle != 0) glDeleteBuffers(1, &handle);
+			handle = other.handle;
+			other.handle = 0;
+		}
+		return *this;
+	}
+	GLBuffer(const GLBuffer &) = delete;
+	GLBuffer &operator=(const GLBuffer &) = delete;
+
+	unsigned int get() const { return handle; }
+};
+
+class GLVertexArray
+{
+	unsigned int handle;
+
+public:
+	GLVertexArray() { glGenVertexArrays(1, &handle); }
+	~GLVertexArray() { if (handle != 0) glDeleteVertexArrays(1, &handle); }
+	GLVertexArray(GLVertexArray &&other) : handle(other.handle) { other.handle = 0; }
+	GLVertexArray &operator=(GLVertexArray &&other)
+	{
+		if (this != &other) {
+			if (handle != 0) glDeleteVertexArrays(1, &handle);
+			handle = other.handle;
+			other.handle = 0;
+		}
+		return *this;
+	}
+	GLVertexArray(const GLVertexArray &) = delete;
+	GLVertexArray &operator=(const GLVertexArray &) = delete;
+
+	unsigned int get() const { return handle; }
+};
+
+class GLShader
+{
+	unsigned int handle;
+
+public:
+	GLShader(GLenum type) { handle = glCreateShader(type); }
+	~GLShader() { if (handle != 0) glDeleteShader(handle); }
+	GLShader(GLShader &&other) : handle(other.handle) { other.handle = 0; }
+	GLShader &operator=(GLShader &&other)
+	{
+		if (this != &other) {
+			if (handle != 0) glDeleteShader(handle);
+			handle = other.handle;
+			other.handle = 0;
+		}
+		return *this;
+	}
+	GLShader(const GLShader &) = delete;
+	GLShader &operator=(const GLShader &) = delete;
+
+	unsigned int get() const { return handle; }
+};
+
+class GLProgram
+{
+	unsigned int handle;
+
+public:
+	GLProgram() { handle = glCreateProgram(); }
+	~GLProgram() { if (handle != 0) glDeleteProgram(handle); }
+	GLProgram(GLProgram &&other) : handle(other.handle) { other.handle = 0; }
+	GLProgram &operator=(GLProgram &&other)
+	{
+		if (this != &other) {
+			if (handle != 0) glDeleteProgram(handle);
+			handle = other.handle;
+			other.handle = 0;
+		}
+		return *this;
+	}
+	GLProgram(const GLProgram &) = delete;
+	GLProgram &operator=(const GLProgram &) = delete;
+
+	unsigned int get() const { return handle; }
+};
+
+//A point in the command stream the CPU can wait for the graphics card to get past
+class GLFence
+{
+	GLsync sync;
+
+public:
+	GLFence() { sync = NULL; }
+	~GLFence() { if (sync != NULL) glDeleteSync(sync); }
+	GLFence(const GLFence &) = delete;
+	GLFence &operator=(const GLFence &) = delete;
+
+	//Marks everything sent to the graphics card so far, replacing any earlier mark
+	void place()
+	{
+		if (sync != NULL) glDeleteSync(sync);
+		sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	//Waits until the graphics card has finished everything before the mark. Returns straight away if there's no mark.
+	void wait()
+	{
+		if (sync == NULL) return;
+		while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+		}
+		glDeleteSync(sync);
+		sync = NULL;
+	}
+
+	//Forgets the mark without waiting for it
+	void clear()
+	{
+		if (sync != NULL) glDeleteSync(sync);
+		sync = NULL;
+	}
+};
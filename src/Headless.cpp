@@ -0,0 +1,336 @@
+//Runs the contact model without a window. This is meant for batch runs on machines without a display: the simulation is
+//stepped as fast as the CPU allows and a one line summary of the outbreak is written out at the end.
+
+//Allows output messages
+#include <iostream>
+#include <fstream>
+
+//Command line parsing
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//Timing of the run
+#include <chrono>
+#include <ctime>
+
+//Circle motion, collision and infection
+#include "Simulation.h"
+
+//The same model run from one collision to the next instead of tick by tick
+#include "EventSimulation.h"
+#include <memory>
+
+//Per-phase timings
+#include "Profiler.h"
+
+//Saving and resuming long runs
+#include "Checkpoint.h"
+
+//Per-tick counts
+#include "TimeSeries.h"
+
+//Who infected whom
+#include "TransmissionLog.h"
+
+//Choosing and checking the SIMD kernels
+#include "SimdKernels.h"
+
+using namespace std;
+
+void printUsage();
+
+int main(int argc, char **argv)
+{
+	//Defaults match the starting values of the windowed program
+	int num_circles = 30;
+	int max_ticks = 100000;
+	double radius = CIRCLE_RADIUS;
+	float sim_speed = 1;
+	bool immunity = true;
+	float infection_chance = 1.0;
+	float average_recovery = 5.0;
+	unsigned long long seed = (unsigned long long)time(NULL);
+	int threads = 0;
+	int max_substeps = MAX_SUBSTEPS;
+	string summary_path;
+	string trace_path;
+	string checkpoint_path;
+	int checkpoint_every = 10000;
+	string resume_path;
+	string series_path;
+	string transmissions_path;
+	string engine = "tick";
+	string simd = "auto";
+	bool verify_simd = false;
+
+	//Read the parameters from the command line
+	for (int arg = 1;arg < argc;arg++) {
+		//Every option except the flags takes a value after it
+		bool has_value = arg + 1 < argc;
+
+		if (strcmp(argv[arg], "--agents") == 0 && has_value) {
+			num_circles = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--ticks") == 0 && has_value) {
+			max_ticks = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--radius") == 0 && has_value) {
+			radius = atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--speed") == 0 && has_value) {
+			sim_speed = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--infection-chance") == 0 && has_value) {
+			infection_chance = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--recovery") == 0 && has_value) {
+			average_recovery = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--seed") == 0 && has_value) {
+			seed = strtoull(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--threads") == 0 && has_value) {
+			threads = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--max-substeps") == 0 && has_value) {
+			max_substeps = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--summary") == 0 && has_value) {
+			summary_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--trace") == 0 && has_value) {
+			trace_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--checkpoint") == 0 && has_value) {
+			checkpoint_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--checkpoint-every") == 0 && has_value) {
+			checkpoint_every = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--series") == 0 && has_value) {
+			series_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--transmissions") == 0 && has_value) {
+			transmissions_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--resume") == 0 && has_value) {
+			resume_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--engine") == 0 && has_value) {
+			engine = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--simd") == 0 && has_value) {
+			simd = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--no-immunity") == 0) {
+			immunity = false;
+		}
+		else if (strcmp(argv[arg], "--verify-simd") == 0) {
+			verify_simd = true;
+		}
+		else {
+			printUsage();
+			return strcmp(argv[arg], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (num_circles < 1 || max_ticks < 0 || radius <= 0.0) {
+		cout << "The number of agents and the radius must be positive" << endl;
+		return 1;
+	}
+	if (engine != "tick" && engine != "event") {
+		cout << "The engine must be tick or event" << endl;
+		return 1;
+	}
+
+	//A checkpoint only holds the circles, and the event engine also keeps when each infected circle will recover, so a run carried
+	//on from one wouldn't match one that was never stopped
+	if (engine == "event" && (!checkpoint_path.empty() || !resume_path.empty())) {
+		cout << "The event engine can't save or resume from checkpoints" << endl;
+		return 1;
+	}
+
+	SimdLevel simd_level;
+	if (!simdLevelFromName(simd, simd_level)) {
+		cout << "The SIMD level must be auto, scalar, sse2, avx2 or avx512" << endl;
+		return 1;
+	}
+
+	setSimulationThreads(threads);
+	setMaxSubsteps(max_substeps);
+	setSimdLevel(simd_level);
+	setSimdVerification(verify_simd);
+	setProfiling(!trace_path.empty());
+
+	AgentStore circles(num_circles);
+	ModelParameters parameters;
+	string error;
+
+	if (resume_path.empty()) {
+		createCircles(circles, seed, radius);
+	}
+	else {
+		//Everything about the model comes from the checkpoint. The tick limit still comes from the command line and counts from
+		//the start of the original run.
+		if (!loadCheckpoint(resume_path, circles, parameters, error)) {
+			cout << error << endl;
+			return 1;
+		}
+		num_circles = parameters.agents;
+		radius = parameters.radius;
+		sim_speed = parameters.sim_speed;
+		immunity = parameters.immunity;
+		infection_chance = parameters.infection_chance;
+		average_recovery = parameters.average_recovery;
+		seed = circles.seed;
+	}
+
+	parameters.agents = num_circles;
+	parameters.max_ticks = max_ticks;
+	parameters.radius = radius;
+	parameters.sim_speed = sim_speed;
+	parameters.immunity = immunity;
+	parameters.infection_chance = infection_chance;
+	parameters.average_recovery = average_recovery;
+
+	//Picks up from wherever the circles were placed or loaded
+	unique_ptr<EventSimulation> events;
+	if (engine == "event") {
+		events.reset(new EventSimulation(circles, parameters));
+	}
+
+	int susceptible;
+	int infected;
+	int recovered;
+	int tick = (int)circles.tick;
+
+	//After a resume the peak only covers the ticks run since then
+	countCompartments(circles, susceptible, infected, recovered);
+	int peak_infected = infected;
+	int peak_tick = tick;
+
+	TimeSeriesWriter series;
+	if (!series_path.empty()) {
+		if (!series.open(series_path, error)) {
+			cout << error << endl;
+			return 1;
+		}
+		series.record(tick, susceptible, infected, recovered, 0, 0);
+	}
+
+	TransmissionLog transmissions;
+	if (!transmissions_path.empty() && !transmissions.open(transmissions_path, error)) {
+		cout << error << endl;
+		return 1;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	//Run until we hit the tick limit or there is nobody left to spread the disease
+	while (tick < max_ticks) {
+		if (events) {
+			events->runTick();
+		}
+		else {
+			circleMotion(circles, immunity, infection_chance, average_recovery, sim_speed);
+		}
+		tick++;
+
+		countCompartments(circles, susceptible, infected, recovered);
+		series.record(tick, susceptible, infected, recovered, circles.new_infections, circles.new_recoveries);
+		transmissions.record(circles.transmissions);
+		if (infected > peak_infected) {
+			peak_infected = infected;
+			peak_tick = tick;
+		}
+		if (infected == 0) {
+			break;
+		}
+
+		if (!checkpoint_path.empty() && checkpoint_every > 0 && tick % checkpoint_every == 0) {
+			if (!saveCheckpoint(checkpoint_path, circles, parameters, error)) {
+				cout << error << endl;
+				return 1;
+			}
+		}
+	}
+
+	//Save where the run ended up too, so it can be carried on with a higher tick limit
+	if (!checkpoint_path.empty() && !saveCheckpoint(checkpoint_path, circles, parameters, error)) {
+		cout << error << endl;
+		return 1;
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (!series.close(error) || !transmissions.close(error)) {
+		cout << error << endl;
+		return 1;
+	}
+	countCompartments(circles, susceptible, infected, recovered);
+
+	//One header line and one row of values, so the output of many runs can be concatenated into a single table
+	string header = "seed,agents,radius,speed,immunity,infection_chance,recovery,ticks,susceptible,infected,recovered,peak_infected,peak_tick,seconds,ticks_per_second";
+	string row = to_string(seed) + "," + to_string(num_circles) + "," + to_string(radius) + "," + to_string(sim_speed) + "," + to_string((int)immunity) + "," +
+		to_string(infection_chance) + "," + to_string(average_recovery) + "," + to_string(tick) + "," + to_string(susceptible) + "," + to_string(infected) + "," +
+		to_string(recovered) + "," + to_string(peak_infected) + "," + to_string(peak_tick) + "," + to_string(seconds) + "," + to_string(seconds > 0.0 ? tick / seconds : 0.0);
+
+	if (!trace_path.empty() && !writeChromeTrace(trace_path)) {
+		cout << "Failed to write " << trace_path << endl;
+		return 1;
+	}
+
+	if (summary_path.empty()) {
+		cout << header << endl << row << endl;
+	}
+	else {
+		//Only write the header if this is a new file, so repeated runs append to the same table
+		ifstream existing(summary_path.c_str());
+		bool write_header = !existing.good() || existing.peek() == ifstream::traits_type::eof();
+		existing.close();
+
+		ofstream summary(summary_path.c_str(), ios::app);
+		if (!summary) {
+			cout << "Failed to open " << summary_path << endl;
+			return 1;
+		}
+		if (write_header) {
+			summary << header << endl;
+		}
+		summary << row << endl;
+	}
+
+	//Any difference at all from the scalar kernels fails the run
+	if (verify_simd && !checkSimdKernels(error)) {
+		cout << error << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+void printUsage()
+{
+	cout << "Usage: Headless [options]" << endl
+		<< "  --agents N             number of circles/people (default 30)" << endl
+		<< "  --ticks N              maximum number of ticks to run (default 100000)" << endl
+		<< "  --radius R             circle radius, the screen is 2 units wide (default 0.05)" << endl
+		<< "  --speed S              simulation speed multiplier (default 1)" << endl
+		<< "  --infection-chance P   chance of infection per contact (default 1.0)" << endl
+		<< "  --recovery T           average recovery time (default 5.0)" << endl
+		<< "  --no-immunity          allow recovered circles to be reinfected" << endl
+		<< "  --seed N               random seed (default: current time)" << endl
+		<< "  --threads N            worker threads, 0 for one per hardware thread (default 0)" << endl
+		<< "  --engine NAME          tick to step every tick, or event to jump from one collision to the next (default tick)" << endl
+		<< "  --max-substeps N       most substeps a tick is split into at high speed, 1 for none (default " << MAX_SUBSTEPS << ")" << endl
+		<< "  --simd LEVEL           scalar, sse2, avx2 or avx512 kernels, or auto for the best the CPU has (default auto)" << endl
+		<< "  --verify-simd          check every SIMD kernel against the scalar one and fail if any result differs" << endl
+		<< "  --summary FILE         append the summary to FILE instead of printing it" << endl
+		<< "  --trace FILE           save the timings of the last ticks as a Chrome trace" << endl
+		<< "  --checkpoint FILE      save the whole simulation to FILE every so often and at the end (tick engine only)" << endl
+		<< "  --checkpoint-every N   ticks between checkpoints (default 10000)" << endl
+		<< "  --series FILE          record every tick's counts, new infections and recoveries to FILE (see SeriesToCsv)" << endl
+		<< "  --transmissions FILE   record who infected whom, when and where to FILE (see TransmissionReport)" << endl
+		<< "  --resume FILE          carry on from a checkpoint, with the model parameters it was saved with (tick engine only)" << endl;
+}
@@ -0,0 +1,144 @@
+#include "MortonOrder.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+using namespace std;
+
+//The keys are sorted a byte at a time
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+//Spreads the low 16 bits of a number out to every other bit, so two of them can be interleaved into one key
+static unsigned int spreadBits(unsigned int value)
+{
+	value &= 0xffff;
+	value = (value | (value << 8)) & 0x00ff00ff;
+	value = (value | (value << 4)) & 0x0f0f0f0f;
+	value = (value | (value << 2)) & 0x33333333;
+	value = (value | (value << 1)) & 0x55555555;
+	return value;
+}
+
+//Puts one of the store's arrays into the new order, using scratch for the copy. The two swap over afterwards, so the scratch
+//space ends up holding the old array's memory, ready for the next array of the same type.
+template <class T>
+static void gather(AlignedVector<T> &array, AlignedVector<T> &scratch, const vector<int> &order, ThreadPool &pool, int blocks)
+{
+	int count = (int)array.size();
+	scratch.resize(count);
+	pool.run(blocks, [&](int block) {
+		for (int agent = count * block / blocks;agent < count * (block + 1) / blocks;agent++) {
+			scratch[agent] = array[order[agent]];
+		}
+	});
+	array.swap(scratch);
+}
+
+void sortByMortonOrder(AgentStore &circles, ThreadPool &pool, int tasks)
+{
+	//Kept between calls so their memory gets reused
+	static thread_local vector<unsigned int> saved_keys;
+	static thread_local vector<unsigned int> saved_next_keys;
+	static thread_local vector<int> saved_order;
+	static thread_local vector<int> saved_next_order;
+	static thread_local vector<int> saved_block_slot;
+	static thread_local AlignedVector<double> double_scratch;
+	static thread_local AlignedVector<unsigned char> state_scratch;
+	static thread_local AlignedVector<unsigned int> id_scratch;
+
+	//The workers have their own thread_local copies, so they're handed this thread's
+	vector<unsigned int> &keys = saved_keys;
+	vector<unsigned int> &next_keys = saved_next_keys;
+	vector<int> &order = saved_order;
+	vector<int> &next_order = saved_next_order;
+	vector<int> &block_slot = saved_block_slot;
+
+	int count = circles.size();
+	if (count < 2) {
+		return;
+	}
+
+	//The same cells SpatialGrid would use: one diameter wide, but no more than a few cells per circle
+	double max_radius = 0.0;
+	for (int circle = 0;circle < count;circle++) {
+		max_radius = max(max_radius, circles.radius[circle]);
+	}
+	int cells_per_side = max(1, int(ceil(2.0 / max(2.0 * max_radius, 1e-6))));
+	cells_per_side = min(cells_per_side, 2 * max(1, int(ceil(sqrt((double)count)))));
+	cells_per_side = min(cells_per_side, 1 << 16);
+	double cell_size = 2.0 / cells_per_side;
+
+	int blocks = max(1, min(tasks, count));
+	keys.resize(count);
+	next_keys.resize(count);
+	order.resize(count);
+	next_order.resize(count);
+
+	pool.run(blocks, [&](int block) {
+		for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+			int column = max(0, min(cells_per_side - 1, int(floor((circles.x[circle] + 1.0) / cell_size))));
+			int row = max(0, min(cells_per_side - 1, int(floor((circles.y[circle] + 1.0) / cell_size))));
+			keys[circle] = spreadBits(column) | (spreadBits(row) << 1);
+			order[circle] = circle;
+		}
+	});
+
+	//Only as many bytes as the keys actually use need sorting
+	int key_bits = 0;
+	while ((1 << key_bits) < cells_per_side) {
+		key_bits++;
+	}
+	int passes = (2 * key_bits + RADIX_BITS - 1) / RADIX_BITS;
+
+	//Each pass is a stable counting sort on one byte. Every block counts the bytes in its part of the keys, the counts are turned
+	//into where each block starts writing each byte value, and then every block drops its keys into place. Blocks write to their
+	//own slots in the order of their keys, so the sort is stable however many blocks there are.
+	block_slot.resize(blocks * RADIX_BUCKETS);
+	for (int pass = 0;pass < passes;pass++) {
+		int shift = pass * RADIX_BITS;
+
+		pool.run(blocks, [&](int block) {
+			int *slot = &block_slot[block * RADIX_BUCKETS];
+			fill(slot, slot + RADIX_BUCKETS, 0);
+			for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+				slot[(keys[circle] >> shift) & (RADIX_BUCKETS - 1)]++;
+			}
+		});
+
+		int offset = 0;
+		for (int bucket = 0;bucket < RADIX_BUCKETS;bucket++) {
+			for (int block = 0;block < blocks;block++) {
+				int bucket_count = block_slot[block * RADIX_BUCKETS + bucket];
+				block_slot[block * RADIX_BUCKETS + bucket] = offset;
+				offset += bucket_count;
+			}
+		}
+
+		pool.run(blocks, [&](int block) {
+			int *slot = &block_slot[block * RADIX_BUCKETS];
+			for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+				int destination = slot[(keys[circle] >> shift) & (RADIX_BUCKETS - 1)]++;
+				next_keys[destination] = keys[circle];
+				next_order[destination] = order[circle];
+			}
+		});
+
+		keys.swap(next_keys);
+		order.swap(next_order);
+	}
+
+	//Move every array into the new order, and note where each id has gone
+	gather(circles.x, double_scratch, order, pool, blocks);
+	gather(circles.y, double_scratch, order, pool, blocks);
+	gather(circles.vx, double_scratch, order, pool, blocks);
+	gather(circles.vy, double_scratch, order, pool, blocks);
+	gather(circles.radius, double_scratch, order, pool, blocks);
+	gather(circles.state, state_scratch, order, pool, blocks);
+	gather(circles.id, id_scratch, order, pool, blocks);
+
+	pool.run(blocks, [&](int block) {
+		for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+			circles.index_of[circles.id[circle]] = circle;
+		}
+	});
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "AgentStore.h"
+#include "ThreadPool.h"
+
+//Circles are created in a random order, and however they start out they wander away from whichever circles were next to them in
+//memory. Looking up a circle's neighbours then jumps all over the arrays. Sorting the circles along a Z-order (Morton) curve of
+//grid cells puts circles that are close together on screen close together in memory again, so the lookups mostly hit the cache.
+//
+//Every agent keeps its id through the move, and the simulation goes by id wherever order matters, so sorting never changes a run.
+
+//Reorders every array in the store by the Morton key of the grid cell each circle is in. Circles in the same cell keep their
+//order. The keys are sorted with a radix sort split into blocks for the pool.
+void sortByMortonOrder(AgentStore &circles, ThreadPool &pool, int tasks);
@@ -0,0 +1,111 @@
+#include "NeighbourList.h"
+#include "SimdKernels.h"
+#include <algorithm>
+
+NeighbourList::NeighbourList()
+{
+	skin = 0.0;
+	built_radius = 0.0;
+}
+
+//Whether the lists have to be made again: some circle has moved more than half the skin, or grown, since they were made, or they
+//were made for a different number of circles. Checking is a single pass over the positions, split into blocks for the pool.
+bool NeighbourList::isStale(AgentStore &circles, ThreadPool &pool, int tasks)
+{
+	int count = circles.size();
+	if (circle_start.size() != count + 1) {
+		return true;
+	}
+
+	double limit = skin * skin / 4.0;
+	int blocks = max(1, min(tasks, count));
+	block_stale.assign(blocks, 0);
+
+	pool.run(blocks, [&](int block) {
+		for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+			double distance_x = circles.x[circle] - built_x[circle];
+			double distance_y = circles.y[circle] - built_y[circle];
+			if (distance_x * distance_x + distance_y * distance_y > limit || circles.radius[circle] > built_radius) {
+				block_stale[block] = 1;
+				return;
+			}
+		}
+	});
+
+	return find(block_stale.begin(), block_stale.end(), 1) != block_stale.end();
+}
+
+//Makes every circle's list from scratch. The grid is rebuilt with cells wide enough to take in the skin, and left that way: until
+//the lists go stale, it can still be used to find every circle that could be touching a given point.
+void NeighbourList::rebuild(AgentStore &circles, SpatialGrid &grid, ThreadPool &pool, int tasks)
+{
+	int count = circles.size();
+
+	built_radius = 0.0;
+	for (int circle = 0;circle < count;circle++) {
+		built_radius = max(built_radius, circles.radius[circle]);
+	}
+	skin = NEIGHBOUR_SKIN * built_radius;
+	built_x.assign(circles.x.begin(), circles.x.end());
+	built_y.assign(circles.y.begin(), circles.y.end());
+
+	grid.rebuild(circles, pool, tasks, skin);
+
+	//Each block of circles makes its own lists, and the length of each circle's list goes in circle_start for now
+	int blocks = max(1, min(tasks, count));
+	block_entries.resize(blocks);
+	block_neighbours.resize(blocks);
+	circle_start.resize(count + 1);
+
+	pool.run(blocks, [&](int block) {
+		vector<int> &lists = block_entries[block];
+		vector<int> &neighbours = block_neighbours[block];
+		lists.clear();
+
+		for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+			int start = (int)lists.size();
+
+			//Everything the grid turns up is checked at once, and whatever is close enough is written straight onto the end
+			grid.findNeighbours(circles.x[circle], circles.y[circle], circle, neighbours);
+			lists.resize(start + neighbours.size());
+			int found = findWithinReach(circles.x[circle], circles.y[circle], circles.radius[circle], skin, circles.x.data(), circles.y.data(), circles.radius.data(),
+				neighbours.data(), (int)neighbours.size(), lists.data() + start);
+			lists.resize(start + found);
+			sort(lists.begin() + start, lists.end());
+			circle_start[circle + 1] = (int)lists.size() - start;
+		}
+	});
+
+	//Turn the lengths into where each list starts, then copy the blocks' lists into place
+	circle_start[0] = 0;
+	for (int circle = 0;circle < count;circle++) {
+		circle_start[circle + 1] += circle_start[circle];
+	}
+	entries.resize(circle_start[count]);
+
+	pool.run(blocks, [&](int block) {
+		copy(block_entries[block].begin(), block_entries[block].end(), entries.begin() + circle_start[count * block / blocks]);
+	});
+}
+
+//The circles in a circle's list are entry(circleBegin(circle)) up to, but not including, entry(circleEnd(circle))
+int NeighbourList::circleBegin(int circle)
+{
+	return circle_start[circle];
+}
+
+int NeighbourList::circleEnd(int circle)
+{
+	return circle_start[circle + 1];
+}
+
+int NeighbourList::entry(int entry)
+{
+	return entries[entry];
+}
+
+//A circle's whole list, for going through it in one go
+const int *NeighbourList::circleEntries(int circle)
+{
+	return entries.data() + circle_start[circle];
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include "AgentStore.h"
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+using namespace std;
+
+//For every circle, the later circles that are close enough to touch it any time soon. Each list holds every circle within the two
+//radii plus a margin called the skin. As long as no circle has moved more than half the skin since the lists were made, no two
+//circles can have closed the gap, so the lists still hold every pair that could be touching and can be used again. Circles only
+//move a small part of a radius each tick, so the lists last for several ticks, and most ticks skip the grid altogether.
+//
+//The lists are stored back to back in one array, in order of circle, with each circle's list sorted. Going through them in order
+//finds the touching pairs in the same order as checking every circle against every later circle.
+
+//The skin, as a fraction of the largest radius
+#define NEIGHBOUR_SKIN 0.25
+
+class NeighbourList
+{
+	//Circle c's list is entries[circle_start[c]] up to entries[circle_start[c+1]]
+	vector<int> circle_start;
+	vector<int> entries;
+
+	//Where every circle was when the lists were made, and the skin and largest radius they were made with
+	AlignedVector<double> built_x;
+	AlignedVector<double> built_y;
+	double skin;
+	double built_radius;
+
+	//Scratch space for building the lists a block of circles at a time
+	vector<vector<int> > block_entries;
+	vector<vector<int> > block_neighbours;
+	vector<char> block_stale;
+
+public:
+	NeighbourList();
+	bool isStale(AgentStore &circles, ThreadPool &pool, int tasks);
+	void rebuild(AgentStore &circles, SpatialGrid &grid, ThreadPool &pool, int tasks);
+	int circleBegin(int circle);
+	int circleEnd(int circle);
+	int entry(int entry);
+	const int *circleEntries(int circle);
+};
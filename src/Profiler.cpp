@@ -0,0 +1,155 @@
+#include "Profiler.h"
+
+//Reading the clock
+#include <chrono>
+
+//Writing the trace file
+#include <fstream>
+#include <iomanip>
+
+//Putting the timings back in order
+#include <algorithm>
+
+//Matching timings by name
+#include <cstring>
+
+atomic<bool> profiling_enabled(false);
+
+//One entry of the ring buffer. The sequence number is the position the timing was written for plus one, and is zero while a
+//thread is partway through writing it, so a reader can tell a finished timing from a half-written or overwritten one.
+struct ProfileSlot
+{
+	atomic<unsigned long long> sequence;
+	ProfileEvent event;
+};
+
+static ProfileSlot profile_slots[PROFILE_CAPACITY];
+static atomic<unsigned long long> profile_next(0);
+static atomic<int> profile_next_thread(0);
+
+static const chrono::steady_clock::time_point profile_epoch = chrono::steady_clock::now();
+
+void setProfiling(bool enabled)
+{
+	profiling_enabled.store(enabled);
+}
+
+bool isProfiling()
+{
+	return profiling_enabled.load(memory_order_relaxed);
+}
+
+long long profileNow()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - profile_epoch).count();
+}
+
+void recordProfileEvent(const char *name, long long start, long long duration)
+{
+	//Numbers each thread the first time it records anything
+	static thread_local int thread_number = profile_next_thread++;
+
+	unsigned long long position = profile_next.fetch_add(1, memory_order_relaxed);
+	ProfileSlot &slot = profile_slots[position & (PROFILE_CAPACITY - 1)];
+
+	slot.sequence.store(0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot.event.name = name;
+	slot.event.start = start;
+	slot.event.duration = duration;
+	slot.event.thread = thread_number;
+	slot.sequence.store(position + 1, memory_order_release);
+}
+
+//Copies out every finished timing still in the buffer, oldest first
+void profileEvents(vector<ProfileEvent> &events)
+{
+	unsigned long long end = profile_next.load(memory_order_acquire);
+	unsigned long long begin = end > PROFILE_CAPACITY ? end - PROFILE_CAPACITY : 0;
+
+	events.clear();
+	for (unsigned long long position = begin;position < end;position++) {
+		ProfileSlot &slot = profile_slots[position & (PROFILE_CAPACITY - 1)];
+
+		unsigned long long before = slot.sequence.load(memory_order_acquire);
+		ProfileEvent event = slot.event;
+		atomic_thread_fence(memory_order_acquire);
+		unsigned long long after = slot.sequence.load(memory_order_relaxed);
+
+		//Skip anything that was being written while we read it
+		if (before == position + 1 && after == before) {
+			events.push_back(event);
+		}
+	}
+
+	//Timers finish in a different order than they start, and the trace reads best sorted by start
+	sort(events.begin(), events.end(), [](const ProfileEvent &a, const ProfileEvent &b) { return a.start < b.start; });
+}
+
+//Finds the most recent timing with the given name and copies out every timing that ran inside it, starting with the named one
+//itself. Blocks inside it always finish before it does, so they sit just before it in the buffer. Returns false if there isn't
+//one yet.
+bool profileLatest(const char *name, vector<ProfileEvent> &events)
+{
+	unsigned long long end = profile_next.load(memory_order_acquire);
+	unsigned long long begin = end > PROFILE_CAPACITY ? end - PROFILE_CAPACITY : 0;
+	bool found = false;
+	ProfileEvent outer;
+
+	events.clear();
+	for (unsigned long long position = end;position > begin;position--) {
+		ProfileSlot &slot = profile_slots[(position - 1) & (PROFILE_CAPACITY - 1)];
+
+		unsigned long long before = slot.sequence.load(memory_order_acquire);
+		ProfileEvent event = slot.event;
+		atomic_thread_fence(memory_order_acquire);
+		unsigned long long after = slot.sequence.load(memory_order_relaxed);
+
+		if (before != position || after != before) {
+			continue;
+		}
+
+		if (!found) {
+			if (strcmp(event.name, name) == 0) {
+				found = true;
+				outer = event;
+				events.push_back(event);
+			}
+			continue;
+		}
+
+		//Everything from here back finished before the named block started
+		if (event.start + event.duration < outer.start) {
+			break;
+		}
+		if (event.start >= outer.start) {
+			events.push_back(event);
+		}
+	}
+
+	sort(events.begin(), events.end(), [](const ProfileEvent &a, const ProfileEvent &b) { return a.start < b.start; });
+	return found;
+}
+
+//Saves the timings in the Chrome trace event format. Returns false if the file couldn't be written.
+bool writeChromeTrace(const string &path)
+{
+	vector<ProfileEvent> events;
+	profileEvents(events);
+
+	ofstream trace(path.c_str());
+	if (!trace) {
+		return false;
+	}
+
+	//Complete ("X") events, with times in microseconds
+	trace << fixed << setprecision(3) << "{\"traceEvents\":[";
+	for (int event = 0;event < events.size();event++) {
+		trace << (event == 0 ? "\n" : ",\n")
+			<< "{\"name\":\"" << events[event].name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << events[event].thread
+			<< ",\"ts\":" << events[event].start / 1000.0 << ",\"dur\":" << events[event].duration / 1000.0 << "}";
+	}
+	trace << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return trace.good();
+}
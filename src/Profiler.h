@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+using namespace std;
+
+//A small built-in profiler. Wrapping a block of code in PROFILE_SCOPE("name") times it and stores the result in a fixed size
+//ring buffer, which the window shows as a breakdown of the last frame and which can be saved as a Chrome trace (open it in
+//chrome://tracing or ui.perfetto.dev). The buffer is written without locks: every timer claims its own slot from a shared
+//counter, so threads in the pool never wait on each other. Once it fills up the oldest timings are overwritten.
+//
+//Profiling starts switched off. While it's off a timer only checks one flag, so the timers can stay in the code for good.
+
+//How many timings are kept. Must be a power of two.
+#define PROFILE_CAPACITY 65536
+
+struct ProfileEvent
+{
+	//Must be a string literal or otherwise live for the rest of the program, since only the pointer is kept
+	const char *name;
+	//Nanoseconds since the profiler started
+	long long start;
+	long long duration;
+	//A small number standing in for the thread that ran the block, for laying the trace out in rows
+	int thread;
+};
+
+void setProfiling(bool enabled);
+bool isProfiling();
+long long profileNow();
+void recordProfileEvent(const char *name, long long start, long long duration);
+void profileEvents(vector<ProfileEvent> &events);
+bool profileLatest(const char *name, vector<ProfileEvent> &events);
+bool writeChromeTrace(const string &path);
+
+extern atomic<bool> profiling_enabled;
+
+//Times the enclosing block. Doesn't read the clock at all while profiling is off.
+class ProfileScope
+{
+	const char *name;
+	long long start;
+
+public:
+	ProfileScope(const char *name)
+	{
+		this->name = name;
+		start = profiling_enabled.load(memory_order_relaxed) ? profileNow() : -1;
+	}
+	~ProfileScope()
+	{
+		if (start >= 0) {
+			recordProfileEvent(name, start, profileNow() - start);
+		}
+	}
+};
+
+#define PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCATENATE(profile_scope_, __LINE__)(name)
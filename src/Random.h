@@ -0,0 +1,65 @@
+#pragma once
+
+//Counter-based random numbers (Philox4x32-10, from Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+//
+//Instead of a generator whose state moves forward with every call like rand(), every random number is worked out directly from
+//where it's used: the seed, the tick, the agent and what the number is for. Asking for the same thing twice gives the same
+//number, no matter which thread asks or in what order. That's what keeps the results identical however the work is split up.
+//Everything here is plain integer math with no shared state, so loops that draw a number per agent can be vectorized.
+
+//What a random number is being used for. Each purpose gets its own stream, so for example recovery draws never line up with
+//infection draws for the same agent and tick.
+enum RandomPurpose : unsigned int
+{
+	RANDOM_PLACEMENT = 1,
+	RANDOM_INFECTION = 2,
+	RANDOM_RECOVERY = 3,
+	RANDOM_SAMPLING = 4
+};
+
+//Runs the ten Philox rounds on the four counter words, keyed by the two seed words
+inline void philox4x32(unsigned int counter[4], unsigned int key0, unsigned int key1)
+{
+	for (int round = 0;round < 10;round++) {
+		unsigned long long product0 = 0xD2511F53ull * counter[0];
+		unsigned long long product1 = 0xCD9E8D57ull * counter[2];
+
+		unsigned int next0 = (unsigned int)(product1 >> 32) ^ counter[1] ^ key0;
+		unsigned int next1 = (unsigned int)product1;
+		unsigned int next2 = (unsigned int)(product0 >> 32) ^ counter[3] ^ key1;
+		unsigned int next3 = (unsigned int)product0;
+
+		counter[0] = next0;
+		counter[1] = next1;
+		counter[2] = next2;
+		counter[3] = next3;
+
+		//Bump the key between rounds with the Weyl constants
+		key0 += 0x9E3779B9u;
+		key1 += 0xBB67AE85u;
+	}
+}
+
+//Turns 64 random bits into a double in [0,1) using the top 53 bits
+inline double randomBitsToUniform(unsigned int high, unsigned int low)
+{
+	return (double)((((unsigned long long)high << 32) | low) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//Two uniform numbers in [0,1) for the given seed, tick, agent, purpose and an extra number that tells apart several draws with
+//otherwise the same address (for example which other agent a contact was with)
+inline void randomUniform2(unsigned long long seed, unsigned int tick, unsigned int agent, unsigned int extra, RandomPurpose purpose, double uniform[2])
+{
+	unsigned int counter[4] = { tick, agent, extra, (unsigned int)purpose };
+	philox4x32(counter, (unsigned int)seed, (unsigned int)(seed >> 32));
+	uniform[0] = randomBitsToUniform(counter[0], counter[1]);
+	uniform[1] = randomBitsToUniform(counter[2], counter[3]);
+}
+
+//A single uniform number in [0,1)
+inline double randomUniform(unsigned long long seed, unsigned int tick, unsigned int agent, unsigned int extra, RandomPurpose purpose)
+{
+	unsigned int counter[4] = { tick, agent, extra, (unsigned int)purpose };
+	philox4x32(counter, (unsigned int)seed, (unsigned int)(seed >> 32));
+	return randomBitsToUniform(counter[0], counter[1]);
+}
@@ -0,0 +1,28 @@
+//Turns a time series recorded by the simulation (Headless --series, or Record Counts in the window) into a CSV table with one
+//row per tick, for loading into a spreadsheet or analysis script.
+
+//Allows output messages
+#include <iostream>
+#include <string>
+
+//Reading the binary format
+#include "TimeSeries.h"
+
+using namespace std;
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		cout << "Usage: SeriesToCsv INPUT OUTPUT" << endl
+			<< "  INPUT                  time series file written by the simulation" << endl
+			<< "  OUTPUT                 CSV file to write" << endl;
+		return argc == 2 && string(argv[1]) == "--help" ? 0 : 1;
+	}
+
+	string error;
+	if (!convertTimeSeriesToCsv(argv[1], argv[2], error)) {
+		cout << error << endl;
+		return 1;
+	}
+	return 0;
+}
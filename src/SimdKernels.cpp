@@ -0,0 +1,617 @@
+#include "SimdKernels.h"
+
+//CIRCLE_SPEED
+#include "Simulation.h"
+
+//The scalar kernels
+#include <algorithm>
+#include <cmath>
+
+//Checking the SIMD kernels against them. Mismatches can turn up on several threads at once.
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+//The SIMD kernels are only written for x86. Anything else always gets the scalar ones.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+//MSVC lets any function use any intrinsic, but GCC and Clang have to be told which functions may use which instructions, since
+//the rest of the program is built for the oldest CPU it runs on
+#if defined(SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_AVX512
+#elif defined(SIMD_X86)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+//AVX-512 brings fused multiply-adds with it, and GCC would otherwise fuse the kernels' separate multiplies and adds, which rounds
+//once instead of twice and stops the results matching the scalar kernels
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+//Rounding error is in the 1e-17 spot, so circles need to overlap by more than this to count as touching
+#define TOUCHING_OVERLAP 1e-16
+
+//The scalar kernels. These are the reference the others have to match, and they also finish off whatever is left over at the
+//end of an array that doesn't fill a whole register.
+
+static void moveScalar(double *x, double *y, const double *vx, const double *vy, int count, float step_speed)
+{
+	for (int circle = 0;circle < count;circle++) {
+		x[circle] = x[circle] + vx[circle] * step_speed * CIRCLE_SPEED;
+		y[circle] = y[circle] + vy[circle] * step_speed * CIRCLE_SPEED;
+	}
+}
+
+static void bounceScalar(double *x, double *y, double *vx, double *vy, const double *radius, int count)
+{
+	for (int circle = 0;circle < count;circle++) {
+		double circle_radius = radius[circle];
+
+		if (x[circle] < -1.0 + circle_radius) {
+			x[circle] = -1.0 + circle_radius;
+			vx[circle] = -vx[circle];
+		}else if (x[circle] > 1.0 - circle_radius) {
+			x[circle] = 1.0 - circle_radius;
+			vx[circle] = -vx[circle];
+		}
+
+		if (y[circle] < -1.0 + circle_radius) {
+			y[circle] = -1.0 + circle_radius;
+			vy[circle] = -vy[circle];
+		}else if (y[circle] > 1.0 - circle_radius) {
+			y[circle] = 1.0 - circle_radius;
+			vy[circle] = -vy[circle];
+		}
+	}
+}
+
+static int touchingScalar(double x, double y, double radius, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *touching)
+{
+	int found = 0;
+	for (int candidate = 0;candidate < count;candidate++) {
+		int other_circle = candidates[candidate];
+		double distance_x = x - xs[other_circle];
+		double distance_y = y - ys[other_circle];
+		if ((radius + radii[other_circle]) - sqrt(distance_x * distance_x + distance_y * distance_y) > TOUCHING_OVERLAP) {
+			touching[found++] = other_circle;
+		}
+	}
+	return found;
+}
+
+static int withinScalar(double x, double y, double radius, double skin, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *within)
+{
+	int found = 0;
+	for (int candidate = 0;candidate < count;candidate++) {
+		int other_circle = candidates[candidate];
+		double distance_x = x - xs[other_circle];
+		double distance_y = y - ys[other_circle];
+		double reach = radius + radii[other_circle] + skin;
+		if (distance_x * distance_x + distance_y * distance_y < reach * reach) {
+			within[found++] = other_circle;
+		}
+	}
+	return found;
+}
+
+#ifdef SIMD_X86
+
+//SSE2: two circles at a time. There's no blend or gather, so the walls pick between values with masks and the candidates are
+//loaded one by one.
+
+TARGET_SSE2 static void moveSse2(double *x, double *y, const double *vx, const double *vy, int count, float step_speed)
+{
+	__m128d speed = _mm_set1_pd(step_speed);
+	__m128d scale = _mm_set1_pd(CIRCLE_SPEED);
+	int circle = 0;
+	for (;circle + 2 <= count;circle += 2) {
+		_mm_storeu_pd(x + circle, _mm_add_pd(_mm_loadu_pd(x + circle), _mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(vx + circle), speed), scale)));
+		_mm_storeu_pd(y + circle, _mm_add_pd(_mm_loadu_pd(y + circle), _mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(vy + circle), speed), scale)));
+	}
+	moveScalar(x + circle, y + circle, vx + circle, vy + circle, count - circle, step_speed);
+}
+
+//Clamps one axis between low and high, and flips the sign of the velocity wherever it had to. Below wins if both are true, as
+//it does in the scalar kernel.
+TARGET_SSE2 static inline void reflectSse2(double *position, double *velocity, __m128d low, __m128d high)
+{
+	__m128d place = _mm_loadu_pd(position);
+	__m128d below = _mm_cmplt_pd(place, low);
+	__m128d above = _mm_andnot_pd(below, _mm_cmpgt_pd(place, high));
+	place = _mm_or_pd(_mm_and_pd(below, low), _mm_andnot_pd(below, place));
+	place = _mm_or_pd(_mm_and_pd(above, high), _mm_andnot_pd(above, place));
+	_mm_storeu_pd(position, place);
+	_mm_storeu_pd(velocity, _mm_xor_pd(_mm_loadu_pd(velocity), _mm_and_pd(_mm_or_pd(below, above), _mm_set1_pd(-0.0))));
+}
+
+TARGET_SSE2 static void bounceSse2(double *x, double *y, double *vx, double *vy, const double *radius, int count)
+{
+	int circle = 0;
+	for (;circle + 2 <= count;circle += 2) {
+		__m128d circle_radius = _mm_loadu_pd(radius + circle);
+		__m128d low = _mm_add_pd(_mm_set1_pd(-1.0), circle_radius);
+		__m128d high = _mm_sub_pd(_mm_set1_pd(1.0), circle_radius);
+		reflectSse2(x + circle, vx + circle, low, high);
+		reflectSse2(y + circle, vy + circle, low, high);
+	}
+	bounceScalar(x + circle, y + circle, vx + circle, vy + circle, radius + circle, count - circle);
+}
+
+TARGET_SSE2 static int touchingSse2(double x, double y, double radius, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *touching)
+{
+	__m128d center_x = _mm_set1_pd(x);
+	__m128d center_y = _mm_set1_pd(y);
+	__m128d circle_radius = _mm_set1_pd(radius);
+	__m128d limit = _mm_set1_pd(TOUCHING_OVERLAP);
+	int found = 0;
+	int candidate = 0;
+	for (;candidate + 2 <= count;candidate += 2) {
+		int first = candidates[candidate];
+		int second = candidates[candidate + 1];
+		__m128d distance_x = _mm_sub_pd(center_x, _mm_set_pd(xs[second], xs[first]));
+		__m128d distance_y = _mm_sub_pd(center_y, _mm_set_pd(ys[second], ys[first]));
+		__m128d magnitude = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(distance_x, distance_x), _mm_mul_pd(distance_y, distance_y)));
+		__m128d overlap = _mm_sub_pd(_mm_add_pd(circle_radius, _mm_set_pd(radii[second], radii[first])), magnitude);
+		int mask = _mm_movemask_pd(_mm_cmpgt_pd(overlap, limit));
+
+		//Always write the candidate, but only move past it if it counts
+		touching[found] = first;
+		found += mask & 1;
+		touching[found] = second;
+		found += (mask >> 1) & 1;
+	}
+	return found + touchingScalar(x, y, radius, xs, ys, radii, candidates + candidate, count - candidate, touching + found);
+}
+
+TARGET_SSE2 static int withinSse2(double x, double y, double radius, double skin, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *within)
+{
+	__m128d center_x = _mm_set1_pd(x);
+	__m128d center_y = _mm_set1_pd(y);
+	__m128d circle_radius = _mm_set1_pd(radius);
+	__m128d margin = _mm_set1_pd(skin);
+	int found = 0;
+	int candidate = 0;
+	for (;candidate + 2 <= count;candidate += 2) {
+		int first = candidates[candidate];
+		int second = candidates[candidate + 1];
+		__m128d distance_x = _mm_sub_pd(center_x, _mm_set_pd(xs[second], xs[first]));
+		__m128d distance_y = _mm_sub_pd(center_y, _mm_set_pd(ys[second], ys[first]));
+		__m128d squared = _mm_add_pd(_mm_mul_pd(distance_x, distance_x), _mm_mul_pd(distance_y, distance_y));
+		__m128d reach = _mm_add_pd(_mm_add_pd(circle_radius, _mm_set_pd(radii[second], radii[first])), margin);
+		int mask = _mm_movemask_pd(_mm_cmplt_pd(squared, _mm_mul_pd(reach, reach)));
+
+		within[found] = first;
+		found += mask & 1;
+		within[found] = second;
+		found += (mask >> 1) & 1;
+	}
+	return found + withinScalar(x, y, radius, skin, xs, ys, radii, candidates + candidate, count - candidate, within + found);
+}
+
+//AVX2: four circles at a time, with blends for the walls and gathers for the candidates. The scalar kernels that finish off each
+//array aren't built for AVX, and plain SSE instructions run slowly while the top halves of the wide registers hold anything, so
+//they're cleared before handing over.
+
+TARGET_AVX2 static void moveAvx2(double *x, double *y, const double *vx, const double *vy, int count, float step_speed)
+{
+	__m256d speed = _mm256_set1_pd(step_speed);
+	__m256d scale = _mm256_set1_pd(CIRCLE_SPEED);
+	int circle = 0;
+	for (;circle + 4 <= count;circle += 4) {
+		_mm256_storeu_pd(x + circle, _mm256_add_pd(_mm256_loadu_pd(x + circle), _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(vx + circle), speed), scale)));
+		_mm256_storeu_pd(y + circle, _mm256_add_pd(_mm256_loadu_pd(y + circle), _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(vy + circle), speed), scale)));
+	}
+	_mm256_zeroupper();
+	moveScalar(x + circle, y + circle, vx + circle, vy + circle, count - circle, step_speed);
+}
+
+TARGET_AVX2 static inline void reflectAvx2(double *position, double *velocity, __m256d low, __m256d high)
+{
+	__m256d place = _mm256_loadu_pd(position);
+	__m256d below = _mm256_cmp_pd(place, low, _CMP_LT_OQ);
+	__m256d above = _mm256_andnot_pd(below, _mm256_cmp_pd(place, high, _CMP_GT_OQ));
+	place = _mm256_blendv_pd(place, low, below);
+	place = _mm256_blendv_pd(place, high, above);
+	_mm256_storeu_pd(position, place);
+	_mm256_storeu_pd(velocity, _mm256_xor_pd(_mm256_loadu_pd(velocity), _mm256_and_pd(_mm256_or_pd(below, above), _mm256_set1_pd(-0.0))));
+}
+
+TARGET_AVX2 static void bounceAvx2(double *x, double *y, double *vx, double *vy, const double *radius, int count)
+{
+	int circle = 0;
+	for (;circle + 4 <= count;circle += 4) {
+		__m256d circle_radius = _mm256_loadu_pd(radius + circle);
+		__m256d low = _mm256_add_pd(_mm256_set1_pd(-1.0), circle_radius);
+		__m256d high = _mm256_sub_pd(_mm256_set1_pd(1.0), circle_radius);
+		reflectAvx2(x + circle, vx + circle, low, high);
+		reflectAvx2(y + circle, vy + circle, low, high);
+	}
+	_mm256_zeroupper();
+	bounceScalar(x + circle, y + circle, vx + circle, vy + circle, radius + circle, count - circle);
+}
+
+//Loads four of the values at the given indexes. The masked form with a zeroed source is used because the plain one leaves GCC
+//thinking the register it starts from is never set.
+TARGET_AVX2 static inline __m256d gatherAvx2(const double *values, __m128i index)
+{
+	return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), values, index, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+TARGET_AVX2 static int touchingAvx2(double x, double y, double radius, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *touching)
+{
+	__m256d center_x = _mm256_set1_pd(x);
+	__m256d center_y = _mm256_set1_pd(y);
+	__m256d circle_radius = _mm256_set1_pd(radius);
+	__m256d limit = _mm256_set1_pd(TOUCHING_OVERLAP);
+	int found = 0;
+	int candidate = 0;
+	for (;candidate + 4 <= count;candidate += 4) {
+		__m128i index = _mm_loadu_si128((const __m128i *)(candidates + candidate));
+		__m256d distance_x = _mm256_sub_pd(center_x, gatherAvx2(xs, index));
+		__m256d distance_y = _mm256_sub_pd(center_y, gatherAvx2(ys, index));
+		__m256d magnitude = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(distance_x, distance_x), _mm256_mul_pd(distance_y, distance_y)));
+		__m256d overlap = _mm256_sub_pd(_mm256_add_pd(circle_radius, gatherAvx2(radii, index)), magnitude);
+		int mask = _mm256_movemask_pd(_mm256_cmp_pd(overlap, limit, _CMP_GT_OQ));
+		for (int lane = 0;mask != 0 && lane < 4;lane++) {
+			touching[found] = candidates[candidate + lane];
+			found += (mask >> lane) & 1;
+		}
+	}
+	_mm256_zeroupper();
+	return found + touchingScalar(x, y, radius, xs, ys, radii, candidates + candidate, count - candidate, touching + found);
+}
+
+TARGET_AVX2 static int withinAvx2(double x, double y, double radius, double skin, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *within)
+{
+	__m256d center_x = _mm256_set1_pd(x);
+	__m256d center_y = _mm256_set1_pd(y);
+	__m256d circle_radius = _mm256_set1_pd(radius);
+	__m256d margin = _mm256_set1_pd(skin);
+	int found = 0;
+	int candidate = 0;
+	for (;candidate + 4 <= count;candidate += 4) {
+		__m128i index = _mm_loadu_si128((const __m128i *)(candidates + candidate));
+		__m256d distance_x = _mm256_sub_pd(center_x, gatherAvx2(xs, index));
+		__m256d distance_y = _mm256_sub_pd(center_y, gatherAvx2(ys, index));
+		__m256d squared = _mm256_add_pd(_mm256_mul_pd(distance_x, distance_x), _mm256_mul_pd(distance_y, distance_y));
+		__m256d reach = _mm256_add_pd(_mm256_add_pd(circle_radius, gatherAvx2(radii, index)), margin);
+		int mask = _mm256_movemask_pd(_mm256_cmp_pd(squared, _mm256_mul_pd(reach, reach), _CMP_LT_OQ));
+		for (int lane = 0;mask != 0 && lane < 4;lane++) {
+			within[found] = candidates[candidate + lane];
+			found += (mask >> lane) & 1;
+		}
+	}
+	_mm256_zeroupper();
+	return found + withinScalar(x, y, radius, skin, xs, ys, radii, candidates + candidate, count - candidate, within + found);
+}
+
+//AVX-512: eight circles at a time. Comparisons give mask registers, which pick the lanes to change directly.
+
+TARGET_AVX512 static void moveAvx512(double *x, double *y, const double *vx, const double *vy, int count, float step_speed)
+{
+	__m512d speed = _mm512_set1_pd(step_speed);
+	__m512d scale = _mm512_set1_pd(CIRCLE_SPEED);
+	int circle = 0;
+	for (;circle + 8 <= count;circle += 8) {
+		_mm512_storeu_pd(x + circle, _mm512_add_pd(_mm512_loadu_pd(x + circle), _mm512_mul_pd(_mm512_mul_pd(_mm512_loadu_pd(vx + circle), speed), scale)));
+		_mm512_storeu_pd(y + circle, _mm512_add_pd(_mm512_loadu_pd(y + circle), _mm512_mul_pd(_mm512_mul_pd(_mm512_loadu_pd(vy + circle), speed), scale)));
+	}
+	_mm256_zeroupper();
+	moveScalar(x + circle, y + circle, vx + circle, vy + circle, count - circle, step_speed);
+}
+
+//The sign is flipped on the integer bits, since a floating point XOR needs AVX-512DQ
+TARGET_AVX512 static inline void reflectAvx512(double *position, double *velocity, __m512d low, __m512d high)
+{
+	__m512d place = _mm512_loadu_pd(position);
+	__mmask8 below = _mm512_cmp_pd_mask(place, low, _CMP_LT_OQ);
+	__mmask8 above = (__mmask8)(_mm512_cmp_pd_mask(place, high, _CMP_GT_OQ) & ~below);
+	place = _mm512_mask_mov_pd(place, below, low);
+	place = _mm512_mask_mov_pd(place, above, high);
+	_mm512_storeu_pd(position, place);
+	__m512i speed = _mm512_castpd_si512(_mm512_loadu_pd(velocity));
+	speed = _mm512_mask_xor_epi64(speed, (__mmask8)(below | above), speed, _mm512_set1_epi64((long long)0x8000000000000000ull));
+	_mm512_storeu_pd(velocity, _mm512_castsi512_pd(speed));
+}
+
+TARGET_AVX512 static void bounceAvx512(double *x, double *y, double *vx, double *vy, const double *radius, int count)
+{
+	int circle = 0;
+	for (;circle + 8 <= count;circle += 8) {
+		__m512d circle_radius = _mm512_loadu_pd(radius + circle);
+		__m512d low = _mm512_add_pd(_mm512_set1_pd(-1.0), circle_radius);
+		__m512d high = _mm512_sub_pd(_mm512_set1_pd(1.0), circle_radius);
+		reflectAvx512(x + circle, vx + circle, low, high);
+		reflectAvx512(y + circle, vy + circle, low, high);
+	}
+	_mm256_zeroupper();
+	bounceScalar(x + circle, y + circle, vx + circle, vy + circle, radius + circle, count - circle);
+}
+
+//Loads eight of the values at the given indexes, masked for the same reason as gatherAvx2
+TARGET_AVX512 static inline __m512d gatherAvx512(const double *values, __m256i index)
+{
+	return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, index, values, 8);
+}
+
+//The plain square root starts from an undefined register too, so this one is masked as well
+TARGET_AVX512 static inline __m512d sqrtAvx512(__m512d value)
+{
+	return _mm512_maskz_sqrt_pd(0xff, value);
+}
+
+TARGET_AVX512 static int touchingAvx512(double x, double y, double radius, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *touching)
+{
+	__m512d center_x = _mm512_set1_pd(x);
+	__m512d center_y = _mm512_set1_pd(y);
+	__m512d circle_radius = _mm512_set1_pd(radius);
+	__m512d limit = _mm512_set1_pd(TOUCHING_OVERLAP);
+	int found = 0;
+	int candidate = 0;
+	for (;candidate + 8 <= count;candidate += 8) {
+		__m256i index = _mm256_loadu_si256((const __m256i *)(candidates + candidate));
+		__m512d distance_x = _mm512_sub_pd(center_x, gatherAvx512(xs, index));
+		__m512d distance_y = _mm512_sub_pd(center_y, gatherAvx512(ys, index));
+		__m512d magnitude = sqrtAvx512(_mm512_add_pd(_mm512_mul_pd(distance_x, distance_x), _mm512_mul_pd(distance_y, distance_y)));
+		__m512d overlap = _mm512_sub_pd(_mm512_add_pd(circle_radius, gatherAvx512(radii, index)), magnitude);
+		int mask = _mm512_cmp_pd_mask(overlap, limit, _CMP_GT_OQ);
+		for (int lane = 0;mask != 0 && lane < 8;lane++) {
+			touching[found] = candidates[candidate + lane];
+			found += (mask >> lane) & 1;
+		}
+	}
+	_mm256_zeroupper();
+	return found + touchingScalar(x, y, radius, xs, ys, radii, candidates + candidate, count - candidate, touching + found);
+}
+
+TARGET_AVX512 static int withinAvx512(double x, double y, double radius, double skin, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *within)
+{
+	__m512d center_x = _mm512_set1_pd(x);
+	__m512d center_y = _mm512_set1_pd(y);
+	__m512d circle_radius = _mm512_set1_pd(radius);
+	__m512d margin = _mm512_set1_pd(skin);
+	int found = 0;
+	int candidate = 0;
+	for (;candidate + 8 <= count;candidate += 8) {
+		__m256i index = _mm256_loadu_si256((const __m256i *)(candidates + candidate));
+		__m512d distance_x = _mm512_sub_pd(center_x, gatherAvx512(xs, index));
+		__m512d distance_y = _mm512_sub_pd(center_y, gatherAvx512(ys, index));
+		__m512d squared = _mm512_add_pd(_mm512_mul_pd(distance_x, distance_x), _mm512_mul_pd(distance_y, distance_y));
+		__m512d reach = _mm512_add_pd(_mm512_add_pd(circle_radius, gatherAvx512(radii, index)), margin);
+		int mask = _mm512_cmp_pd_mask(squared, _mm512_mul_pd(reach, reach), _CMP_LT_OQ);
+		for (int lane = 0;mask != 0 && lane < 8;lane++) {
+			within[found] = candidates[candidate + lane];
+			found += (mask >> lane) & 1;
+		}
+	}
+	_mm256_zeroupper();
+	return found + withinScalar(x, y, radius, skin, xs, ys, radii, candidates + candidate, count - candidate, within + found);
+}
+
+#endif
+
+//One set of kernels for each level
+struct KernelSet
+{
+	void (*move)(double *, double *, const double *, const double *, int, float);
+	void (*bounce)(double *, double *, double *, double *, const double *, int);
+	int (*touching)(double, double, double, const double *, const double *, const double *, const int *, int, int *);
+	int (*within)(double, double, double, double, const double *, const double *, const double *, const int *, int, int *);
+};
+
+static const KernelSet kernel_sets[] = {
+	{ moveScalar, bounceScalar, touchingScalar, withinScalar },
+#ifdef SIMD_X86
+	{ moveSse2, bounceSse2, touchingSse2, withinSse2 },
+	{ moveAvx2, bounceAvx2, touchingAvx2, withinAvx2 },
+	{ moveAvx512, bounceAvx512, touchingAvx512, withinAvx512 }
+#endif
+};
+
+SimdLevel detectSimdLevel()
+{
+#if defined(SIMD_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int highest = info[0];
+	__cpuid(info, 1);
+
+	//AVX needs the operating system to save the wider registers, which it says through XGETBV
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool os_saves = (info[2] & (1 << 27)) != 0;
+	unsigned long long saved = os_saves ? _xgetbv(0) : 0;
+	bool avx = (info[2] & (1 << 28)) != 0 && (saved & 0x6) == 0x6;
+	bool avx2 = false;
+	bool avx512 = false;
+	if (highest >= 7) {
+		__cpuidex(info, 7, 0);
+		avx2 = avx && (info[1] & (1 << 5)) != 0;
+		avx512 = avx2 && (info[1] & (1 << 16)) != 0 && (saved & 0xe6) == 0xe6;
+	}
+#elif defined(SIMD_X86)
+	//GCC's checks already take in whether the operating system saves the registers
+	__builtin_cpu_init();
+	bool sse2 = __builtin_cpu_supports("sse2");
+	bool avx2 = __builtin_cpu_supports("avx2");
+	bool avx512 = avx2 && __builtin_cpu_supports("avx512f");
+#else
+	bool sse2 = false;
+	bool avx2 = false;
+	bool avx512 = false;
+#endif
+	return avx512 ? SIMD_AVX512 : avx2 ? SIMD_AVX2 : sse2 ? SIMD_SSE2 : SIMD_SCALAR;
+}
+
+static SimdLevel current_level = detectSimdLevel();
+static const KernelSet *kernels = &kernel_sets[current_level];
+
+void setSimdLevel(SimdLevel level)
+{
+	current_level = min(level, detectSimdLevel());
+	kernels = &kernel_sets[current_level];
+}
+
+SimdLevel simdLevel()
+{
+	return current_level;
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+	switch (level) {
+	case SIMD_SSE2:
+		return "SSE2";
+	case SIMD_AVX2:
+		return "AVX2";
+	case SIMD_AVX512:
+		return "AVX-512";
+	default:
+		return "scalar";
+	}
+}
+
+bool simdLevelFromName(const string &name, SimdLevel &level)
+{
+	if (name == "auto") {
+		level = detectSimdLevel();
+	}
+	else if (name == "scalar") {
+		level = SIMD_SCALAR;
+	}
+	else if (name == "sse2") {
+		level = SIMD_SSE2;
+	}
+	else if (name == "avx2") {
+		level = SIMD_AVX2;
+	}
+	else if (name == "avx512") {
+		level = SIMD_AVX512;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+static bool verify_kernels = false;
+static atomic<long long> mismatches(0);
+static atomic<const char *> first_mismatch(NULL);
+
+void setSimdVerification(bool verify)
+{
+	verify_kernels = verify;
+	mismatches = 0;
+	first_mismatch = NULL;
+}
+
+bool checkSimdKernels(string &error)
+{
+	if (mismatches == 0) {
+		return true;
+	}
+	error = to_string(mismatches.load()) + " calls to the " + simdLevelName(current_level) + " kernels gave different results from the scalar ones, starting with " + first_mismatch.load();
+	return false;
+}
+
+static void noteMismatch(const char *kernel)
+{
+	const char *none = NULL;
+	first_mismatch.compare_exchange_strong(none, kernel);
+	mismatches++;
+}
+
+//Whether two arrays hold exactly the same bits
+template <class T>
+static bool sameBits(const T *first, const T *second, int count)
+{
+	return count <= 0 || memcmp(first, second, count * sizeof(T)) == 0;
+}
+
+//Each kernel runs the scalar one on a copy first when verifying. The copies are kept per thread, since the pool runs kernels on
+//several threads at once.
+
+void moveCircles(double *x, double *y, const double *vx, const double *vy, int count, float step_speed)
+{
+	if (!verify_kernels) {
+		kernels->move(x, y, vx, vy, count, step_speed);
+		return;
+	}
+
+	static thread_local vector<double> expected_x;
+	static thread_local vector<double> expected_y;
+	expected_x.assign(x, x + count);
+	expected_y.assign(y, y + count);
+	moveScalar(expected_x.data(), expected_y.data(), vx, vy, count, step_speed);
+
+	kernels->move(x, y, vx, vy, count, step_speed);
+	if (!sameBits(x, expected_x.data(), count) || !sameBits(y, expected_y.data(), count)) {
+		noteMismatch("moveCircles");
+	}
+}
+
+void bounceOffWalls(double *x, double *y, double *vx, double *vy, const double *radius, int count)
+{
+	if (!verify_kernels) {
+		kernels->bounce(x, y, vx, vy, radius, count);
+		return;
+	}
+
+	static thread_local vector<double> expected_x;
+	static thread_local vector<double> expected_y;
+	static thread_local vector<double> expected_vx;
+	static thread_local vector<double> expected_vy;
+	expected_x.assign(x, x + count);
+	expected_y.assign(y, y + count);
+	expected_vx.assign(vx, vx + count);
+	expected_vy.assign(vy, vy + count);
+	bounceScalar(expected_x.data(), expected_y.data(), expected_vx.data(), expected_vy.data(), radius, count);
+
+	kernels->bounce(x, y, vx, vy, radius, count);
+	if (!sameBits(x, expected_x.data(), count) || !sameBits(y, expected_y.data(), count) || !sameBits(vx, expected_vx.data(), count) ||
+		!sameBits(vy, expected_vy.data(), count)) {
+		noteMismatch("bounceOffWalls");
+	}
+}
+
+int findTouching(double x, double y, double radius, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *touching)
+{
+	if (!verify_kernels) {
+		return kernels->touching(x, y, radius, xs, ys, radii, candidates, count, touching);
+	}
+
+	static thread_local vector<int> expected;
+	expected.resize(count);
+	int expected_found = touchingScalar(x, y, radius, xs, ys, radii, candidates, count, expected.data());
+
+	int found = kernels->touching(x, y, radius, xs, ys, radii, candidates, count, touching);
+	if (found != expected_found || !sameBits(touching, expected.data(), found)) {
+		noteMismatch("findTouching");
+	}
+	return found;
+}
+
+int findWithinReach(double x, double y, double radius, double skin, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *within)
+{
+	if (!verify_kernels) {
+		return kernels->within(x, y, radius, skin, xs, ys, radii, candidates, count, within);
+	}
+
+	static thread_local vector<int> expected;
+	expected.resize(count);
+	int expected_found = withinScalar(x, y, radius, skin, xs, ys, radii, candidates, count, expected.data());
+
+	int found = kernels->within(x, y, radius, skin, xs, ys, radii, candidates, count, within);
+	if (found != expected_found || !sameBits(within, expected.data(), found)) {
+		noteMismatch("findWithinReach");
+	}
+	return found;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+using namespace std;
+
+//The loops that run over every circle every tick, written once as plain scalar code and again with SSE2, AVX2 and AVX-512
+//intrinsics. Which set is used is decided at runtime from what the CPU supports, so one build runs everywhere and still uses the
+//widest registers the machine has.
+//
+//Every SIMD kernel does the same arithmetic in the same order as the scalar one, without fused multiply-adds, so they all give
+//exactly the same bits. With verification turned on, every call also runs the scalar kernel and compares the two.
+
+enum SimdLevel
+{
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+
+//The widest instruction set both the CPU and the operating system support
+SimdLevel detectSimdLevel();
+
+//Picks which kernels are used. Asking for more than the CPU supports gets the best it does support. Only call this while no
+//simulation is running.
+void setSimdLevel(SimdLevel level);
+SimdLevel simdLevel();
+const char *simdLevelName(SimdLevel level);
+
+//Reads scalar, sse2, avx2, avx512 or auto, the last meaning whatever the CPU supports
+bool simdLevelFromName(const string &name, SimdLevel &level);
+
+//Runs the scalar kernel alongside every SIMD kernel and counts each call whose results differ by even a bit. Returns false and
+//says what differed if any have since verification was turned on.
+void setSimdVerification(bool verify);
+bool checkSimdKernels(string &error);
+
+//Moves count circles along their velocities by one step
+void moveCircles(double *x, double *y, const double *vx, const double *vy, int count, float step_speed);
+
+//Puts any of count circles that have gone past a side of the screen back on it, heading back in
+void bounceOffWalls(double *x, double *y, double *vx, double *vy, const double *radius, int count);
+
+//Checks one circle against count candidates, given as indexes into the position and radius arrays. The candidates it overlaps,
+//by the test the collision pass uses, are written to touching in the order given, and the number of them is returned. touching
+//needs room for count.
+int findTouching(double x, double y, double radius, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *touching);
+
+//The same, but for candidates whose centres are closer than the two radii plus skin, checked on the squared distance
+int findWithinReach(double x, double y, double radius, double skin, const double *xs, const double *ys, const double *radii, const int *candidates, int count, int *within);
@@ -0,0 +1,489 @@
+#include "Simulation.h"
+
+//Sorting of neighbour lists
+#include <algorithm>
+
+//Keeping circles that are near each other on screen near each other in memory
+#include "MortonOrder.h"
+
+//Gives random number generation
+#include "Random.h"
+#include <cmath>
+
+//Uniform grid and neighbour lists used to find which circles are close enough to collide
+#include "SpatialGrid.h"
+#include "NeighbourList.h"
+
+//Worker threads for the collision pass
+#include "ThreadPool.h"
+
+//Timers for each phase of a tick
+#include "Profiler.h"
+
+//SSE2, AVX2 and AVX-512 versions of the loops over every circle, picked to suit the CPU
+#include "SimdKernels.h"
+
+//Below this many circles a tick is over faster than it takes to wake up the worker threads
+#define PARALLEL_THRESHOLD 4096
+
+//How many ticks go by between putting the circles back into Morton order. It's only done when the neighbour lists are being
+//made again anyway, and only for populations too big for the cache to hold, since smaller ones get nothing out of it.
+#define REORDER_TICKS 64
+#define REORDER_THRESHOLD 65536
+
+//The pool the simulation runs on. It is only created the first time it's needed, so the thread count can be set beforehand.
+static ThreadPool *simulation_threads = NULL;
+
+static ThreadPool &simulationThreads()
+{
+	if (simulation_threads == NULL) {
+		simulation_threads = new ThreadPool();
+	}
+	return *simulation_threads;
+}
+
+//Sets how many threads the simulation uses. Zero means one per hardware thread.
+void setSimulationThreads(int threads)
+{
+	delete simulation_threads;
+	simulation_threads = new ThreadPool(threads);
+}
+
+ModelParameters::ModelParameters()
+{
+	agents = 30;
+	max_ticks = 10000;
+	radius = CIRCLE_RADIUS;
+	sim_speed = 1;
+	immunity = true;
+	infection_chance = 1.0;
+	average_recovery = 5.0;
+}
+
+//Places the circles randomly on the screen, moving in random directions, with a single infected circle to start the outbreak
+void createCircles(AgentStore &circles, unsigned long long seed, double radius)
+{
+	double angle;
+	double random[2];
+
+	circles.seed = seed;
+	circles.tick = 0;
+
+	//Each circle's id is where it's created, and that's what picks out its random numbers
+	circles.resetOrder();
+
+	for (int i = 0;i < circles.size();i++) {
+
+		//Calculate random position
+		randomUniform2(seed, 0, i, 0, RANDOM_PLACEMENT, random);
+		circles.x[i] = random[0] * 2 - 1;
+		circles.y[i] = random[1] * 2 - 1;
+		circles.radius[i] = radius;
+
+		//Calculate random velocity angle
+		angle = randomUniform(seed, 0, i, 1, RANDOM_PLACEMENT) * 2 * PI;
+
+		//Calculate Cartesian components of velocity
+		circles.vx[i] = cos(angle);
+		circles.vy[i] = sin(angle);
+
+		//Everyone starts out uninfected
+		circles.state[i] = SUSCEPTIBLE;
+	}
+
+	//Check for circle overlap before the program starts
+	circleCollision(circles, false, 0.0, 0.0, 0.0);
+
+	//Start an infection. Note that I've done this after the collision detection has already run once, so that any circles that were initially overlapping don't infect each other
+	//The collision pass may already have moved the circles around in memory, so the first circle is found by its id.
+	circles.state[circles.index_of[0]] = INFECTED;
+	circles.recount();
+}
+
+//The most a circle may move in one substep, as a fraction of the smallest radius. Two circles heading straight at each other then
+//close by at most one radius between them, so they're caught touching before they can get more than halfway into each other, let
+//alone pass through.
+#define SUBSTEP_DISPLACEMENT 0.5
+
+static int max_substeps = MAX_SUBSTEPS;
+
+//Sets the most substeps a tick can be split into. One turns substepping off.
+void setMaxSubsteps(int substeps)
+{
+	max_substeps = max(1, substeps);
+}
+
+//How many substeps this tick needs so that no circle moves further than SUBSTEP_DISPLACEMENT of the smallest radius in any of
+//them. Usually this is one, and the tick runs exactly as it always has.
+static int substepCount(AgentStore &circles, float sim_speed)
+{
+	if (max_substeps <= 1 || circles.size() == 0) {
+		return 1;
+	}
+
+	const double *vx = circles.vx.data();
+	const double *vy = circles.vy.data();
+	const double *radius = circles.radius.data();
+	int count = circles.size();
+	int blocks = (count + PARALLEL_THRESHOLD - 1) / PARALLEL_THRESHOLD;
+
+	//Each block finds its own fastest speed and smallest radius. The workers have their own thread_local copies, so they're
+	//handed this thread's.
+	static thread_local vector<double> block_speeds;
+	static thread_local vector<double> block_radii;
+	vector<double> &speeds = block_speeds;
+	vector<double> &radii = block_radii;
+	speeds.assign(blocks, 0.0);
+	radii.assign(blocks, radius[0]);
+
+	auto scan = [&](int block) {
+		int end = min(count, (block + 1) * PARALLEL_THRESHOLD);
+		double fastest = 0.0;
+		double smallest = radius[block * PARALLEL_THRESHOLD];
+		for (int circle = block * PARALLEL_THRESHOLD;circle < end;circle++) {
+			fastest = max(fastest, vx[circle] * vx[circle] + vy[circle] * vy[circle]);
+			smallest = min(smallest, radius[circle]);
+		}
+		speeds[block] = fastest;
+		radii[block] = smallest;
+	};
+
+	//This runs every tick, so a population small enough for one block skips the pool altogether
+	if (blocks == 1) {
+		scan(0);
+	}
+	else {
+		simulationThreads().run(blocks, scan);
+	}
+
+	double fastest = *max_element(speeds.begin(), speeds.end());
+	double smallest = *min_element(radii.begin(), radii.end());
+	if (smallest <= 0.0) {
+		return 1;
+	}
+
+	double displacement = sqrt(fastest) * fabs(sim_speed) * CIRCLE_SPEED;
+	int substeps = (int)ceil(displacement / (SUBSTEP_DISPLACEMENT * smallest));
+	return max(1, min(substeps, max_substeps));
+}
+
+//Advances the simulation by one tick: resolves collisions and infections, then moves every circle. If the circles would move too
+//far in one go to be sure of catching every collision, the tick is split into substeps, each a collision pass and a shorter move.
+void circleMotion(AgentStore &circles, bool immunity, float infection_chance, float average_recovery, float sim_speed)
+{
+	PROFILE_SCOPE("circleMotion");
+
+	int substeps = substepCount(circles, sim_speed);
+	float step_speed = sim_speed / substeps;
+
+	for (int substep = 0;substep < substeps;substep++) {
+		circleCollision(circles, immunity, infection_chance, average_recovery, step_speed, substep);
+
+		PROFILE_SCOPE("Movement");
+
+		//Work straight on the arrays. Nothing in here depends on another circle, so each block is moved by the widest SIMD kernel
+		//the CPU has, and big populations are split into blocks for the thread pool.
+		double *x = circles.x.data();
+		double *y = circles.y.data();
+		const double *vx = circles.vx.data();
+		const double *vy = circles.vy.data();
+		int count = circles.size();
+		int blocks = (count + PARALLEL_THRESHOLD - 1) / PARALLEL_THRESHOLD;
+
+		simulationThreads().run(blocks, [&](int block) {
+			int start = block * PARALLEL_THRESHOLD;
+			int end = min(count, start + PARALLEL_THRESHOLD);
+			moveCircles(x + start, y + start, vx + start, vy + start, end - start, step_speed);
+		});
+	}
+	circles.tick++;
+}
+
+//Finds every pair among the given circles and the circles in their neighbour lists that overlap at the start of the tick. Each
+//pair is stored once, as a single number with the lower id in the top half and the higher one in the bottom half, so sorting
+//the numbers puts the pairs in the same order that checking every circle against every later circle by id would find them.
+static void findContacts(AgentStore &circles, NeighbourList &list, int first_circle, int last_circle, vector<unsigned long long> &contacts)
+{
+	//The circles in one list that overlap, kept so its memory gets reused
+	static thread_local vector<int> touching;
+
+	contacts.clear();
+
+	for (int circle = first_circle;circle < last_circle;circle++) {
+		int listed = list.circleEnd(circle) - list.circleBegin(circle);
+		if (listed == 0) {
+			continue;
+		}
+
+		//The whole list is checked at once, with the same test circleCollision uses, so the two always agree on what counts as
+		//touching
+		touching.resize(listed);
+		int found = findTouching(circles.x[circle], circles.y[circle], circles.radius[circle], circles.x.data(), circles.y.data(), circles.radius.data(),
+			list.circleEntries(circle), listed, touching.data());
+
+		unsigned int circle_id = circles.id[circle];
+		for (int other = 0;other < found;other++) {
+			unsigned int other_id = circles.id[touching[other]];
+			contacts.push_back(((unsigned long long)min(circle_id, other_id) << 32) | max(circle_id, other_id));
+		}
+	}
+}
+
+//Resolves collisions in two phases. First the circles are split into blocks, and the pool finds the overlapping pairs in each
+//block's neighbour lists at the same time. Then the pairs are sorted and applied one at a time, in the same order as checking
+//every circle against every later circle by id. Only the first phase runs in parallel, but it is the part that does nearly all of
+//the work, and because the second phase always sees the same sorted list the result doesn't depend on how many threads there are
+//or on how the circles are ordered in memory.
+//
+//When a tick is split into substeps, this runs once for each of them. The counts of new infections and recoveries and the list of
+//transmissions cover the whole tick, so they're only cleared on the first. A pair that touches again later in the same tick gets
+//the same random number for infection, so splitting a tick up never gives it a second chance.
+void circleCollision(AgentStore &circles, bool immunity, float infection_chance, float average_recovery, float sim_speed, int substep)
+{
+	double position[2];
+	double distance[2];
+	double velocity[2];
+	double other_velocity[2];
+	double radius;
+	double overlap;
+	double dot;
+	double magnitude;
+
+	//The chance of recovering on any single tick
+	double recovery_chance = 1 / (average_recovery * TICKS_PER_SECOND) * sim_speed;
+
+	//Which states can catch the disease. Without immunity, recovered circles can be infected again.
+	unsigned char infectable = immunity ? SUSCEPTIBLE : (SUSCEPTIBLE | RECOVERED);
+
+	//The grid, neighbour lists and contact lists are kept between calls so that their memory gets reused every tick, and the
+	//neighbour lists themselves for as long as they stay good. Each thread gets its own, so several simulations can run side by
+	//side as long as each one sticks to a single thread. Starting another simulation on the same thread moves every circle, so
+	//the lists are never used for the wrong one.
+	static thread_local SpatialGrid grid;
+	static thread_local NeighbourList list;
+	static thread_local vector<vector<unsigned long long> > block_contacts;
+	static thread_local vector<unsigned long long> contacts;
+	static thread_local vector<int> neighbours;
+	static thread_local vector<int> new_neighbours;
+	static thread_local vector<int> block_recoveries;
+
+	//When the circles were last put into Morton order. Only ever used to decide when to do it again, so it doesn't matter if it
+	//was for another simulation.
+	static thread_local unsigned int last_reorder = 0;
+	static thread_local bool reordered = false;
+
+	PROFILE_SCOPE("circleCollision");
+
+	if (substep == 0) {
+		circles.new_infections = 0;
+		circles.new_recoveries = 0;
+		circles.transmissions.clear();
+	}
+
+	ThreadPool &pool = simulationThreads();
+
+	//Small populations aren't worth splitting up, so they run as a single task
+	int tasks = circles.size() < PARALLEL_THRESHOLD ? 1 : pool.size() * 4;
+
+	//Make the neighbour lists again if any circle has moved too far since last time. This also sorts every circle into the grid.
+	//Every so often, put the circles back into Morton order first, since the lists have to be made again after that anyway.
+	if (list.isStale(circles, pool, tasks)) {
+		bool reorder_due = circles.tick < last_reorder || circles.tick - last_reorder >= REORDER_TICKS || !reordered;
+		if (circles.size() >= REORDER_THRESHOLD && reorder_due) {
+			PROFILE_SCOPE("Morton reorder");
+			sortByMortonOrder(circles, pool, tasks);
+			last_reorder = circles.tick;
+			reordered = true;
+		}
+
+		PROFILE_SCOPE("Neighbour list rebuild");
+		list.rebuild(circles, grid, pool, tasks);
+	}
+
+	//Phase one: find the overlapping pairs
+	int count = circles.size();
+	int blocks = max(1, min(tasks, count));
+
+	//The workers have their own thread_local copies of these, so they're handed this thread's
+	NeighbourList &shared_list = list;
+	vector<vector<unsigned long long> > &found_contacts = block_contacts;
+	found_contacts.resize(blocks);
+
+	pool.run(blocks, [&](int block) {
+		PROFILE_SCOPE("Contact search");
+		findContacts(circles, shared_list, count * block / blocks, count * (block + 1) / blocks, found_contacts[block]);
+	});
+
+	contacts.clear();
+	for (int block = 0;block < blocks;block++) {
+		contacts.insert(contacts.end(), found_contacts[block].begin(), found_contacts[block].end());
+	}
+	//Until the circles have been reordered, going through them in order already finds the pairs in order of id
+	if (!is_sorted(contacts.begin(), contacts.end())) {
+		sort(contacts.begin(), contacts.end());
+	}
+
+	//Phase two: apply the contacts in order
+	{
+		PROFILE_SCOPE("Contact apply");
+
+		int next_contact = 0;
+
+		//Only circles that were touching another at the start of the tick can collide, so the rest are skipped
+		while (next_contact < contacts.size()) {
+			unsigned int circle_id = (unsigned int)(contacts[next_contact] >> 32);
+			int circle = circles.index_of[circle_id];
+
+			//Poll the current attributes of the circle of interest
+			position[0] = circles.x[circle];
+			position[1] = circles.y[circle];
+			velocity[0] = circles.vx[circle];
+			velocity[1] = circles.vy[circle];
+			radius = circles.radius[circle];
+
+			//The circles this one was touching at the start of the tick, all with a higher id than it
+			neighbours.clear();
+			for (;next_contact < contacts.size() && (unsigned int)(contacts[next_contact] >> 32) == circle_id;next_contact++) {
+				neighbours.push_back(circles.index_of[(unsigned int)(contacts[next_contact] & 0xffffffff)]);
+			}
+
+			//Check for collisions between circles
+			for (int neighbour = 0;neighbour < neighbours.size();neighbour++) {
+				int other_circle = neighbours[neighbour];
+
+				//Calculates vector between the two circles
+				distance[0] = position[0] - circles.x[other_circle];
+				distance[1] = position[1] - circles.y[other_circle];
+
+				//The magnitude of the distance vector
+				magnitude = sqrt(distance[0] * distance[0] + distance[1] * distance[1]);
+
+				//The amount of overlap between the two circles
+				overlap = (radius + circles.radius[other_circle])-magnitude;
+
+				//Rounding error is in the 1e-17 spot, so this avoids weird rounding errors that might not shift the circles quite all of the way out of each other
+				if (overlap>1e-16) {
+					//Poll the velocity of the other circle
+					other_velocity[0] = circles.vx[other_circle];
+					other_velocity[1] = circles.vy[other_circle];
+
+					//Convert the displacement vector to a unit vector
+					distance[0] = distance[0] / magnitude;
+					distance[1] = distance[1] / magnitude;
+
+					//Shift the position to avoid clipping
+					position[0] = position[0] + distance[0] * overlap;
+					position[1] = position[1] + distance[1] * overlap;
+
+					//The shift may have pushed this circle into circles it wasn't touching at the start of the tick. Swap the rest of the list
+					//for every later circle around the new position. This only happens on an actual collision, so it's rare next to phase one.
+					//The grid was last built with the neighbour lists, but its cells are wide enough to allow for how far circles can have
+					//moved since.
+					unsigned int other_id = circles.id[other_circle];
+					grid.findNeighbours(position[0], position[1], -1, new_neighbours);
+					new_neighbours.erase(remove_if(new_neighbours.begin(), new_neighbours.end(), [&](int found) { return circles.id[found] <= other_id; }), new_neighbours.end());
+					sort(new_neighbours.begin(), new_neighbours.end(), [&](int first, int second) { return circles.id[first] < circles.id[second]; });
+					neighbours.resize(neighbour + 1);
+					neighbours.insert(neighbours.end(), new_neighbours.begin(), new_neighbours.end());
+
+					//Compute the dot product between the velocity and the normal vector to the plane of incidence
+					dot = velocity[0] * (-distance[0]) + velocity[1] * (-distance[1]);
+
+					//Adjust the velocity using the reflection formula
+					velocity[0] = velocity[0] - 2 * dot * (-distance[0]);
+					velocity[1] = velocity[1] - 2 * dot * (-distance[1]);
+
+					//Compute the dot product between the other velocity and the normal vector to the plane of incidence
+					dot = other_velocity[0] * distance[0] + other_velocity[1] * distance[1];
+
+					//Adjust the other velocity using the reflection formula
+					other_velocity[0] = other_velocity[0] - 2 * dot * distance[0];
+					other_velocity[1] = other_velocity[1] - 2 * dot * distance[1];
+
+					//Set the velocity for the other circle
+					circles.vx[other_circle] = other_velocity[0];
+					circles.vy[other_circle] = other_velocity[1];
+
+					//Check for infection transmission. This can only happen when exactly one of the two circles is infected.
+					if ((circles.state[circle] ^ circles.state[other_circle]) & INFECTED) {
+						if (randomUniform(circles.seed, circles.tick, circle_id, circles.id[other_circle], RANDOM_INFECTION) < infection_chance) {
+							//The circle that isn't infected yet catches it, unless it is immune
+							int target = (circles.state[circle] & INFECTED) ? other_circle : circle;
+							if (circles.state[target] & infectable) {
+								if (circles.state[target] & SUSCEPTIBLE) {
+									circles.susceptible--;
+								}
+								else {
+									circles.recovered--;
+								}
+								circles.infected++;
+								circles.state[target] = INFECTED;
+								circles.new_infections++;
+
+								//Infections only happen in this phase, which runs on one thread, so a single list keeps them in order
+								Transmission transmission;
+								transmission.tick = circles.tick;
+								transmission.infector = circles.id[target == circle ? other_circle : circle];
+								transmission.infectee = circles.id[target];
+								transmission.x = (float)((position[0] + circles.x[other_circle]) / 2);
+								transmission.y = (float)((position[1] + circles.y[other_circle]) / 2);
+								circles.transmissions.push_back(transmission);
+							}
+						}
+					}
+				}
+
+			}
+
+
+			//Set the circle attributes as calculated
+			circles.x[circle] = position[0];
+			circles.y[circle] = position[1];
+			circles.vx[circle] = velocity[0];
+			circles.vy[circle] = velocity[1];
+		}
+	}
+
+	//Phase three: walls and recovery. By now every collision this tick is done, and nothing here depends on another circle or on
+	//the order the random numbers are drawn in, so the circles are split into blocks across the pool.
+	blocks = (count + PARALLEL_THRESHOLD - 1) / PARALLEL_THRESHOLD;
+
+	//Each block counts its own recoveries. The workers have their own thread_local copies, so they're handed this thread's.
+	vector<int> &recoveries = block_recoveries;
+	recoveries.assign(blocks, 0);
+
+	pool.run(blocks, [&](int block) {
+		PROFILE_SCOPE("Walls and recovery");
+		int start = block * PARALLEL_THRESHOLD;
+		int end = min(count, start + PARALLEL_THRESHOLD);
+
+		//Checks for collisions between the circles and the sides of the screen
+		//I've intentionally put this last, as I want the circles to stay inside the screen more than I care about them slightly clipping into each other
+		bounceOffWalls(circles.x.data() + start, circles.y.data() + start, circles.vx.data() + start, circles.vy.data() + start, circles.radius.data() + start, end - start);
+
+		for (int circle = start;circle < end;circle++) {
+			//Check for recovered. Each substep draws its own number, against its share of the tick's chance.
+			if ((circles.state[circle] & INFECTED) && randomUniform(circles.seed, circles.tick, circles.id[circle], substep, RANDOM_RECOVERY) < recovery_chance) {
+				circles.state[circle] = RECOVERED;
+				recoveries[block]++;
+			}
+		}
+	});
+
+	int recovered = 0;
+	for (int block = 0;block < blocks;block++) {
+		recovered += recoveries[block];
+	}
+	circles.new_recoveries += recovered;
+	circles.infected -= recovered;
+	circles.recovered += recovered;
+}
+
+//How many circles are susceptible, infected and recovered. These are kept up to date as the circles change state, so this doesn't
+//have to look at any of them.
+void countCompartments(AgentStore &circles, int &susceptible, int &infected, int &recovered)
+{
+	susceptible = circles.susceptible;
+	infected = circles.infected;
+	recovered = circles.recovered;
+}
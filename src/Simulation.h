@@ -0,0 +1,37 @@
+#pragma once
+
+//The simulation itself: how circles move, bounce off each other, infect each other and recover. None of this knows about
+//OpenGL, so it can be run with or without a window.
+#include "AgentStore.h"
+
+//Sets simulation parameters
+#define PI 3.14159265358979323846
+#define CIRCLE_RADIUS 0.05
+#define CIRCLE_SPEED 0.01
+//The number of ticks that make up one unit of recovery time. This matches the framerate the simulation was originally tuned at.
+#define TICKS_PER_SECOND 60
+//The most substeps a tick can be split into when the circles move too far in one to catch every collision, unless
+//setMaxSubsteps says otherwise
+#define MAX_SUBSTEPS 8
+
+//Everything that describes one run of the model apart from its seed
+struct ModelParameters
+{
+	int agents;
+	int max_ticks;
+	double radius;
+	float sim_speed;
+	bool immunity;
+	float infection_chance;
+	float average_recovery;
+
+	//Defaults match the starting values of the windowed program
+	ModelParameters();
+};
+
+void createCircles(AgentStore &circles, unsigned long long seed, double radius = CIRCLE_RADIUS);
+void circleMotion(AgentStore &circles, bool immunity, float infection_chance, float average_recovery, float sim_speed);
+void circleCollision(AgentStore &circles, bool immunity, float infection_chance, float average_recovery, float sim_speed, int substep = 0);
+void countCompartments(AgentStore &circles, int &susceptible, int &infected, int &recovered);
+void setSimulationThreads(int threads);
+void setMaxSubsteps(int substeps);
@@ -0,0 +1,302 @@
+#include "SimulationThread.h"
+
+//Seeding restarts from the clock
+#include <ctime>
+#include <algorithm>
+
+//Saving and loading the whole simulation
+#include "Checkpoint.h"
+
+//How many commands can be waiting at once. The simulation thread empties the queue every time round its loop, so this only has to
+//cover a few frames of dragging sliders.
+#define COMMAND_QUEUE 256
+
+SimulationSnapshot::SimulationSnapshot()
+{
+	tick = 0;
+	susceptible = 0;
+	infected = 0;
+	recovered = 0;
+	running = false;
+	started = false;
+	ticks_per_second = 0;
+	uncapped = false;
+	loads = 0;
+	recording_counts = false;
+	recording_transmissions = false;
+}
+
+SimulationThread::SimulationThread(const ModelParameters &parameters, const function<void()> &published) : circles(parameters.agents), parameters(parameters), commands(COMMAND_QUEUE), published(published)
+{
+	running = false;
+	started = false;
+	uncapped = false;
+	loads = 0;
+	tick_accumulator = 0.0;
+	ticks_this_second = 0;
+	ticks_per_second = 0;
+	quitting = false;
+
+	restart();
+	publish();
+
+	last_accumulated = chrono::steady_clock::now();
+	second_started = last_accumulated;
+	worker = thread(&SimulationThread::run, this);
+}
+
+SimulationThread::~SimulationThread()
+{
+	send(COMMAND_QUIT);
+	worker.join();
+}
+
+//Asks the simulation thread to do something. It's picked up the next time the thread goes round its loop.
+void SimulationThread::send(SimulationCommandType type, int number, float value)
+{
+	SimulationCommand command;
+	command.type = type;
+	command.number = number;
+	command.value = value;
+
+	//The queue only fills up if the simulation thread is stuck in a very long tick, and the command must not be lost
+	while (!commands.push(command)) {
+		this_thread::yield();
+	}
+
+	//Taking the lock means the simulation thread is either not asleep yet, and will see the command before it sleeps, or already
+	//waiting, and gets woken up
+	{
+		lock_guard<mutex> guard(sleep_lock);
+	}
+	command_sent.notify_one();
+}
+
+//The newest snapshot the simulation thread has handed over
+const SimulationSnapshot &SimulationThread::latest()
+{
+	snapshots.update();
+	return snapshots.front();
+}
+
+void SimulationThread::run()
+{
+	chrono::steady_clock::time_point last_published = chrono::steady_clock::now();
+	chrono::duration<double> snapshot_interval(1.0 / SNAPSHOT_RATE);
+
+	while (!quitting) {
+		bool changed = false;
+		SimulationCommand command;
+		while (!quitting && commands.pop(command)) {
+			apply(command);
+			changed = true;
+		}
+		if (quitting) {
+			break;
+		}
+
+		if (running) {
+			runTicks();
+		}
+
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (now - second_started >= chrono::seconds(1)) {
+			ticks_per_second = ticks_this_second;
+			ticks_this_second = 0;
+			second_started = now;
+			changed = true;
+		}
+
+		//Hand over what happened, straight away if a command changed something and otherwise at about the frame rate
+		if (changed || (running && now - last_published >= snapshot_interval)) {
+			publish();
+			last_published = now;
+		}
+
+		//Paused, so there's nothing to do until the next command
+		if (!running) {
+			unique_lock<mutex> guard(sleep_lock);
+			command_sent.wait(guard, [&]() { return !commands.empty(); });
+			continue;
+		}
+
+		//Sleep until the next tick is due, but not so long that snapshots are held up, and wake straight away for a command
+		double wait = 1.0 / SNAPSHOT_RATE;
+		if (!uncapped && parameters.sim_speed > 0.0f) {
+			wait = min(wait, (1.0 - tick_accumulator) / (TICKS_PER_SECOND * parameters.sim_speed));
+		}
+		else if (uncapped) {
+			wait = 0.0;
+		}
+		if (wait > 0.0) {
+			unique_lock<mutex> guard(sleep_lock);
+			command_sent.wait_for(guard, chrono::duration<double>(wait), [&]() { return !commands.empty(); });
+		}
+	}
+
+	//Anything still being recorded is finished off by the destructors, once this thread is done with them
+}
+
+//Carries out a command from the window
+void SimulationThread::apply(const SimulationCommand &command)
+{
+	string error;
+
+	switch (command.type) {
+	case COMMAND_START:
+		//Time spent paused doesn't count towards the next tick
+		running = true;
+		started = true;
+		last_accumulated = chrono::steady_clock::now();
+		break;
+	case COMMAND_PAUSE:
+		//Nothing runs while paused, so the count would otherwise be stuck at whatever it was
+		running = false;
+		ticks_this_second = 0;
+		ticks_per_second = 0;
+		break;
+	case COMMAND_RESTART:
+		restart();
+		break;
+	case COMMAND_SET_AGENTS:
+		circles.resize(max(1, command.number));
+		restart();
+		running = false;
+		break;
+	case COMMAND_SET_IMMUNITY:
+		parameters.immunity = command.number != 0;
+		break;
+	case COMMAND_SET_INFECTION_CHANCE:
+		parameters.infection_chance = command.value;
+		break;
+	case COMMAND_SET_RECOVERY:
+		parameters.average_recovery = command.value;
+		break;
+	case COMMAND_SET_SPEED:
+		parameters.sim_speed = command.value;
+		break;
+	case COMMAND_SET_UNCAPPED:
+		uncapped = command.number != 0;
+		break;
+	case COMMAND_SAVE_CHECKPOINT:
+		parameters.agents = circles.size();
+		checkpoint_message = saveCheckpoint("checkpoint.bin", circles, parameters, error) ? "Saved checkpoint.bin" : error;
+		break;
+	case COMMAND_LOAD_CHECKPOINT:
+		if (loadCheckpoint("checkpoint.bin", circles, parameters, error)) {
+			//Show it, but wait for Start before carrying on
+			running = false;
+			started = true;
+			loads++;
+			checkpoint_message = "Loaded checkpoint.bin";
+
+			//The curve can't be carried across, so it starts again from the loaded tick
+			curve.clear();
+			curve.add(circles.tick, circles.susceptible, circles.infected, circles.recovered);
+		}
+		else {
+			checkpoint_message = error;
+		}
+		break;
+	case COMMAND_RECORD_COUNTS:
+		if (command.number != 0) {
+			series_message = series.open("series.bin", error) ? "Recording to series.bin" : error;
+		}
+		else if (series.isOpen()) {
+			series_message = series.close(error) ? "Saved series.bin" : error;
+		}
+		break;
+	case COMMAND_RECORD_TRANSMISSIONS:
+		if (command.number != 0) {
+			transmissions_message = transmissions.open("transmissions.bin", error) ? "Recording to transmissions.bin" : error;
+		}
+		else if (transmissions.isOpen()) {
+			transmissions_message = transmissions.close(error) ? "Saved transmissions.bin" : error;
+		}
+		break;
+	case COMMAND_QUIT:
+		quitting = true;
+		break;
+	}
+}
+
+//Starts the simulation over with a new seed
+void SimulationThread::restart()
+{
+	createCircles(circles, (unsigned long long)time(NULL));
+	curve.clear();
+}
+
+//Runs however many ticks are owed since last time. Each tick is a fixed step; anything left over carries on to the next call. If
+//the ticks can't keep up, stop once they've used up a frame's worth of time and drop the backlog, otherwise the backlog would keep
+//growing and the snapshots would come further and further apart.
+void SimulationThread::runTicks()
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	tick_accumulator += chrono::duration<double>(start - last_accumulated).count() * TICKS_PER_SECOND * parameters.sim_speed;
+	last_accumulated = start;
+
+	while (uncapped || tick_accumulator >= 1.0) {
+		circleMotion(circles, parameters.immunity, parameters.infection_chance, parameters.average_recovery, 1.0f);
+		curve.add(circles.tick, circles.susceptible, circles.infected, circles.recovered);
+		if (series.isOpen()) {
+			series.record(circles.tick, circles.susceptible, circles.infected, circles.recovered, circles.new_infections, circles.new_recoveries);
+		}
+		if (transmissions.isOpen()) {
+			transmissions.record(circles.transmissions);
+		}
+		tick_accumulator -= 1.0;
+		ticks_this_second++;
+
+		if (chrono::steady_clock::now() - start > chrono::duration<double>(1.0 / SNAPSHOT_RATE)) {
+			tick_accumulator = 0.0;
+			break;
+		}
+	}
+	if (uncapped) {
+		tick_accumulator = 0.0;
+	}
+}
+
+//Copies everything the window needs into the spare snapshot and hands it over
+void SimulationThread::publish()
+{
+	SimulationSnapshot &snapshot = snapshots.back();
+
+	int count = circles.size();
+	snapshot.x.resize(count);
+	snapshot.y.resize(count);
+	snapshot.radius.resize(count);
+	snapshot.state.assign(circles.state.begin(), circles.state.end());
+	for (int circle = 0;circle < count;circle++) {
+		snapshot.x[circle] = (float)circles.x[circle];
+		snapshot.y[circle] = (float)circles.y[circle];
+		snapshot.radius[circle] = (float)circles.radius[circle];
+	}
+
+	snapshot.tick = circles.tick;
+	snapshot.susceptible = circles.susceptible;
+	snapshot.infected = circles.infected;
+	snapshot.recovered = circles.recovered;
+	snapshot.curve = curve;
+
+	snapshot.running = running;
+	snapshot.started = started;
+	snapshot.ticks_per_second = ticks_per_second;
+	snapshot.parameters = parameters;
+	snapshot.parameters.agents = count;
+	snapshot.uncapped = uncapped;
+	snapshot.loads = loads;
+
+	snapshot.recording_counts = series.isOpen();
+	snapshot.recording_transmissions = transmissions.isOpen();
+	snapshot.checkpoint_message = checkpoint_message;
+	snapshot.series_message = series_message;
+	snapshot.transmissions_message = transmissions_message;
+
+	snapshots.publish();
+
+	if (published) {
+		published();
+	}
+}
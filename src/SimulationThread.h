@@ -0,0 +1,143 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "Simulation.h"
+#include "EpidemicCurve.h"
+#include "TimeSeries.h"
+#include "TransmissionLog.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+using namespace std;
+
+//Runs the simulation on a thread of its own, so a slow tick never holds up drawing or the controls. The window thread never touches
+//the simulation directly. It asks for changes by sending commands through a queue, and it draws from snapshots that the simulation
+//thread hands back through a triple buffer at about the frame rate. Neither thread ever waits for the other.
+//
+//While paused, the simulation thread sleeps until a command comes in, and it tells the window every time it hands over a snapshot,
+//so the window can sleep too until there's something new to draw.
+
+//How often the simulation hands over a snapshot while it's running
+#define SNAPSHOT_RATE 60
+
+enum SimulationCommandType
+{
+	COMMAND_START,
+	COMMAND_PAUSE,
+	COMMAND_RESTART,
+	COMMAND_SET_AGENTS,
+	COMMAND_SET_IMMUNITY,
+	COMMAND_SET_INFECTION_CHANCE,
+	COMMAND_SET_RECOVERY,
+	COMMAND_SET_SPEED,
+	COMMAND_SET_UNCAPPED,
+	COMMAND_SAVE_CHECKPOINT,
+	COMMAND_LOAD_CHECKPOINT,
+	COMMAND_RECORD_COUNTS,
+	COMMAND_RECORD_TRANSMISSIONS,
+	COMMAND_QUIT
+};
+
+//A change asked for by the controls. Only the field that goes with the type is used: whole numbers and on/off switches go in
+//number, everything else in value.
+struct SimulationCommand
+{
+	SimulationCommandType type;
+	int number;
+	float value;
+};
+
+//Everything the window needs to draw a frame, as the simulation was at one moment
+struct SimulationSnapshot
+{
+	//Floats are plenty for drawing
+	vector<float> x;
+	vector<float> y;
+	vector<float> radius;
+	vector<unsigned char> state;
+
+	unsigned int tick;
+	int susceptible;
+	int infected;
+	int recovered;
+	EpidemicCurve curve;
+
+	bool running;
+	//Whether the simulation has been started or loaded yet. Nothing is drawn before then.
+	bool started;
+	int ticks_per_second;
+
+	//The parameters the simulation is running with. loads goes up by one every time a checkpoint is loaded, so the controls know
+	//to take the loaded parameters on.
+	ModelParameters parameters;
+	bool uncapped;
+	unsigned int loads;
+
+	//Files being written and what became of the last thing asked of them
+	bool recording_counts;
+	bool recording_transmissions;
+	string checkpoint_message;
+	string series_message;
+	string transmissions_message;
+
+	SimulationSnapshot();
+};
+
+class SimulationThread
+{
+	//Everything below here up to the thread is only ever touched by the simulation thread
+	AgentStore circles;
+	ModelParameters parameters;
+	bool running;
+	bool started;
+	bool uncapped;
+	unsigned int loads;
+
+	//How many ticks are owed to the simulation. Real time is added to this as it goes by, and a tick is run for every whole tick
+	//that has built up, so the simulation runs at the same rate however long each tick takes.
+	double tick_accumulator;
+	chrono::steady_clock::time_point last_accumulated;
+
+	//For showing how many ticks are actually being run each second
+	int ticks_this_second;
+	int ticks_per_second;
+	chrono::steady_clock::time_point second_started;
+
+	EpidemicCurve curve;
+	TimeSeriesWriter series;
+	TransmissionLog transmissions;
+	string checkpoint_message;
+	string series_message;
+	string transmissions_message;
+
+	SpscQueue<SimulationCommand> commands;
+	TripleBuffer<SimulationSnapshot> snapshots;
+
+	//For sleeping while paused. Only used to wake the simulation thread up: the commands themselves go through the queue.
+	mutex sleep_lock;
+	condition_variable command_sent;
+
+	//Called on the simulation thread after every snapshot
+	function<void()> published;
+
+	bool quitting;
+	thread worker;
+
+	void run();
+	void apply(const SimulationCommand &command);
+	void restart();
+	void runTicks();
+	void publish();
+
+public:
+	SimulationThread(const ModelParameters &parameters, const function<void()> &published = function<void()>());
+	~SimulationThread();
+
+	//Window thread only
+	void send(SimulationCommandType type, int number = 0, float value = 0.0f);
+	const SimulationSnapshot &latest();
+};
@@ -8,6 +8,16 @@
 //Allows use of vector objects
 #include <vector>
 
+//Owns the circle renderer
+#include <memory>
+
+//Names of the profiled blocks
+#include <string>
+#include <cstring>
+
+//Fitting the epidemic curve to the window
+#include <algorithm>
+
 //Gives random number generation
 #include<cstdlib>
 #include <time.h>
@@ -17,8 +27,20 @@
 #include "examples/imgui_impl_glfw.h"
 #include "examples/imgui_impl_opengl3.h"
 
-//Circle class
-#include "Circle.h"
+//Circle motion, collision and infection
+#include "Simulation.h"
+
+//Timers for each part of a frame
+#include "Profiler.h"
+
+//Drawing the circles
+#include "CircleRenderer.h"
+
+//The live plot of the outbreak
+#include "EpidemicCurve.h"
+
+//Running the simulation alongside the window
+#include "SimulationThread.h"
 
 using namespace std;
 
@@ -26,23 +48,20 @@ using namespace std;
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 void drawInSquareViewport(GLFWwindow* window);
-void generateCircles(vector<Circle> &circles);
-void createCircles(vector<Circle> &circles, int VAO);
-void circleMotion(vector<Circle> &circles, bool immunity, float infection_chance, float average_recovery);
-void circleCollision(vector<Circle> &circles, bool immunity, float infection_chance, float average_recovery);
-void drawCircles(vector<Circle> &circles, int shaderProgram);
 
 //Sets program parameters
-#define PI 3.14159265358979323846
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
-#define NUM_CIRCLE_VERTICES 100
-#define CIRCLE_RADIUS 0.05
-#define CIRCLE_SPEED 0.01
 #define FRAMERATE 60
+//How many more frames to draw after something happens while paused. The controls need a frame or two to catch up with a click.
+#define SETTLE_FRAMES 3
 
 int num_circles = 30;
+//How many ticks to run per second, as a multiple of TICKS_PER_SECOND. Every tick is the same size, so a faster simulation runs
+//more ticks rather than bigger ones.
 float sim_speed = 1;
+//Whether to ignore sim_speed and run as many ticks as fit in each frame
+bool uncapped = false;
 
 //Sets virus parameters
 //Whether the population is capable of being reinfected by the disease
@@ -54,39 +73,6 @@ float average_recovery = 5.0;
 
 
 
-//Source code for the vertex shader. This program is written for OpenGL and describes how to transform the vertex data to put it on the screen
-const char *vertexShaderSource = "#version 330 core\n"
-"layout (location=0) in vec3 position;\n" //Specifies that the position vector should be put in location 0
-
-//This matrix will hold the scaling and translational data for the drawing of the entire circle
-"uniform mat4 mvMatrix;\n"
-
-//This will hold the rgb color data
-"uniform vec3 color;\n"
-
-"out VS_OUT {\n"
-"	vec4 color;\n"
-"} vs_out;\n"
-
-
-"void main()\n"
-"{\n"
-"	gl_Position=mvMatrix*vec4(position,1.0);\n"
-"	vs_out.color=vec4(color, 1.0);\n"
-"}\0";
-
-//Source code for the fragment shader. This program is also written for OpenGL and describes how to color shapes that we are passing in. It colors everything the same color.
-const char *fragmentShaderSource = "#version 330 core\n"
-    "out vec4 FragColor;\n"
-	"in VS_OUT{\n"
-	"	vec4 color;\n"
-	"} fs_in;\n"
-    "void main()\n"
-    "{\n"
-    "   FragColor = fs_in.color;\n"
-	"}\0";
-
-
 int main()
 {
 	//Intialize GLFW (our window and graphics control interface)
@@ -112,6 +98,9 @@ int main()
 	//Makes the window the current place to draw stuff. This tells OpenGL where the image data that it is about to render should go.
 	glfwMakeContextCurrent(window);
 
+	//Wait for the screen to be ready for the next image instead of drawing frames that are never seen
+	glfwSwapInterval(1);
+
 	//Checks to make sure that GLAD has appropriately loaded before we try to do anything with OpenGL calls.
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 	{
@@ -125,54 +114,6 @@ int main()
 	//References our program to link OpenGL with the instructions on what to do in the event of a window resize 
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-	//Compile and build the vertex shader program
-	unsigned int vertexShader;
-	vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-	glCompileShader(vertexShader);
-
-	//Check if the vertex shader actually built properly. It would be bad to try to render with it if it doesn't work.
-	int success;
-	char infoLog[512];
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	//Print out any error messages
-	if (!success) {
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	//Compile and build the fragment shader program
-	unsigned int fragmentShader;
-	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-	glCompileShader(fragmentShader);
-
-	//Check if the fragment shader built properly
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	//Print any error messages
-	if (!success) {
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	//Now we need to link the two shaders into one program
-	unsigned int shaderProgram;
-	shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);
-
-	//Check if the program built properly
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-	}
-
-	//Since the shaders have been built into a program, we can now delete them
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-
 	//initialize IMGUI
 	{
 		// Setup Dear ImGui context
@@ -190,50 +131,92 @@ int main()
 		ImGui_ImplOpenGL3_Init("#version 330");
 	}
 
-	//Generate array of circles
-	vector<Circle> *circles = new vector<Circle>(num_circles);
-	generateCircles(*circles);
+	//Builds the shaders and the circle mesh. They last until the window closes, however many times the simulation is restarted.
+	unique_ptr<CircleRenderer> renderer(new CircleRenderer());
+
+	//Start the simulation on its own thread, with the values the controls start at
+	ModelParameters parameters;
+	parameters.agents = num_circles;
+	parameters.sim_speed = sim_speed;
+	parameters.immunity = immunity;
+	parameters.infection_chance = infection_chance;
+	parameters.average_recovery = average_recovery;
+	//Every snapshot wakes the window up, in case it's asleep waiting for something to change
+	unique_ptr<SimulationThread> simulation(new SimulationThread(parameters, []() { glfwPostEmptyEvent(); }));
 
 	//Saves the time for framerate comparisons
 	double time_at_beginning_of_previous_frame = glfwGetTime();
 
-	bool simulationRunning = false;
-	bool settingUpSim = true;
+	//How many checkpoints the controls have taken the parameters from
+	unsigned int loads_seen = 0;
+
+	//How many more frames to draw before sleeping until something happens
+	int frames_to_settle = SETTLE_FRAMES;
 
+	//The breakdown of the last frame shown in the control window
+	bool profiling = false;
+	vector<ProfileEvent> frame_events;
+	string trace_message;
 
-	//Event loop. This contains what the program should do every frame.
+	//The epidemic curve reduced to the width of the plot
+	vector<float> plot_ticks;
+	vector<float> plot_values;
+	vector<ImVec2> plot_points;
+
+
+	//Event loop. This contains what the program should do every frame. The simulation carries on by itself, so all this does is
+	//draw whatever it last handed over and pass on anything changed in the controls.
 	while (!glfwWindowShouldClose(window))
 	{
-		if (simulationRunning)
-		{
-			//Checks to see if enough time has passed to bother rendering another frame
-			if (glfwGetTime() < time_at_beginning_of_previous_frame + 1.0 / FRAMERATE)
-			{
-				continue;
+		//Wait for a reason to draw another frame, handling input as it comes in. While the simulation is running, that's the next
+		//frame being due. While it's paused, nothing changes on screen unless there's some input or the simulation hands over a new
+		//snapshot, so sleep until one of those happens.
+		if (simulation->latest().running) {
+			double next_frame = time_at_beginning_of_previous_frame + 1.0 / FRAMERATE;
+			glfwPollEvents();
+			while (glfwGetTime() < next_frame && !glfwWindowShouldClose(window)) {
+				glfwWaitEventsTimeout(next_frame - glfwGetTime());
 			}
-			//Saves the current time to reference on the next iterations of the loop
-			time_at_beginning_of_previous_frame = glfwGetTime();
+			frames_to_settle = SETTLE_FRAMES;
+		}
+		else if (frames_to_settle > 0) {
+			glfwPollEvents();
+			frames_to_settle--;
+		}
+		else {
+			glfwWaitEvents();
+			frames_to_settle = SETTLE_FRAMES;
+		}
+		time_at_beginning_of_previous_frame = glfwGetTime();
+
+		//The newest complete snapshot. It stays the same for the whole frame even if the simulation hands over another meanwhile.
+		const SimulationSnapshot &snapshot = simulation->latest();
 
-			//Processes any input that has happened since the last frame
-			processInput(window);
+		PROFILE_SCOPE("Frame");
 
-			//Processes the movement of the circle
-			circleMotion(*circles,immunity,infection_chance,average_recovery);
+		//Processes any input that has happened since the last frame
+		processInput(window);
 
+		//A loaded checkpoint brings its own parameters, so the controls move to match
+		if (snapshot.loads != loads_seen) {
+			loads_seen = snapshot.loads;
+			num_circles = snapshot.parameters.agents;
+			sim_speed = snapshot.parameters.sim_speed;
+			immunity = snapshot.parameters.immunity;
+			infection_chance = snapshot.parameters.infection_chance;
+			average_recovery = snapshot.parameters.average_recovery;
 		}
+
 		//Clears and resizes the window appropriately
 		drawInSquareViewport(window);
-		if (!settingUpSim)
+		if (snapshot.started)
 		{
-
-			//Tells OpenGL to use the shaders that we custom made
-			glUseProgram(shaderProgram);
-
-			drawCircles(*circles, shaderProgram);
+			renderer->draw(snapshot.x.data(), snapshot.y.data(), snapshot.radius.data(), snapshot.state.data(), (int)snapshot.state.size());
 		}
 
 		//imgui information
 		{
+			PROFILE_SCOPE("ImGui");
 
 			// Start the Dear ImGui frame
 			ImGui_ImplOpenGL3_NewFrame();
@@ -244,39 +227,145 @@ int main()
 			ImGui::Begin("Simulation Control");
 			{
 				//This reads as:
-				//If this button is clicked, switch the simulation running variable and set setting up sim to false.
-				//The expression in parenthesis of the ImGui::Button says "If the simulationRunning variable is true, display Pause, else display Start"
-				if (ImGui::Button(simulationRunning ? "Pause" : "Start"))
+				//If this button is clicked, tell the simulation to pause if it's running and start if it isn't.
+				//The expression in parenthesis of the ImGui::Button says "If the simulation is running, display Pause, else display Start"
+				if (ImGui::Button(snapshot.running ? "Pause" : "Start"))
 				{
-					simulationRunning = !simulationRunning;
-					if (settingUpSim)
-						settingUpSim = false;
+					simulation->send(snapshot.running ? COMMAND_PAUSE : COMMAND_START);
 				}
 
 				//A button to restart the simulation with new randomly generated circles, positions, and velocities
 				if (ImGui::Button("Restart")) {
-					generateCircles(*circles);
+					simulation->send(COMMAND_RESTART);
+				}
+
+				//Saves the simulation as it is right now, or picks up from the last save with the settings it had
+				if (ImGui::Button("Save Checkpoint")) {
+					simulation->send(COMMAND_SAVE_CHECKPOINT);
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Load Checkpoint")) {
+					simulation->send(COMMAND_LOAD_CHECKPOINT);
+				}
+				if (!snapshot.checkpoint_message.empty()) {
+					ImGui::Text("%s", snapshot.checkpoint_message.c_str());
+				}
+
+				//Records the counts of every tick from here on. Convert the file with SeriesToCsv to read it.
+				bool recording = snapshot.recording_counts;
+				if (ImGui::Checkbox("Record Counts", &recording)) {
+					simulation->send(COMMAND_RECORD_COUNTS, recording);
+				}
+				if (!snapshot.series_message.empty()) {
+					ImGui::SameLine();
+					ImGui::Text("%s", snapshot.series_message.c_str());
+				}
+
+				//Records who infected whom from here on. Read the file with TransmissionReport.
+				bool logging_transmissions = snapshot.recording_transmissions;
+				if (ImGui::Checkbox("Record Transmissions", &logging_transmissions)) {
+					simulation->send(COMMAND_RECORD_TRANSMISSIONS, logging_transmissions);
+				}
+				if (!snapshot.transmissions_message.empty()) {
+					ImGui::SameLine();
+					ImGui::Text("%s", snapshot.transmissions_message.c_str());
 				}
 
 				//A checkbox for the immunity boolean
-				ImGui::Checkbox("Immunity", &immunity);
+				if (ImGui::Checkbox("Immunity", &immunity)) {
+					simulation->send(COMMAND_SET_IMMUNITY, immunity);
+				}
 				
 				//Allows the user to change the number of circles in realtime
 				if (ImGui::InputInt("Number of Circles/People", &num_circles, 1, 100, ImGuiInputTextFlags_AutoSelectAll)) {
-					delete(circles);
-					circles = new vector<Circle>(num_circles);
-					generateCircles(*circles);
-					simulationRunning = false;
+					simulation->send(COMMAND_SET_AGENTS, num_circles);
 				}
 
 				//A slider for the infection chance variable. Bounds are from 0.0 to 1.0
-				ImGui::SliderFloat("Infection Chance", &infection_chance, 0.0f, 1.0f);
+				if (ImGui::SliderFloat("Infection Chance", &infection_chance, 0.0f, 1.0f)) {
+					simulation->send(COMMAND_SET_INFECTION_CHANCE, 0, infection_chance);
+				}
 
 				//A slider for the recovery time variable. Bounds are from 0.0 to 20.0
-				ImGui::SliderFloat("Recovery Time", &average_recovery, 0.0f, 20.0f);
+				if (ImGui::SliderFloat("Recovery Time", &average_recovery, 0.0f, 20.0f)) {
+					simulation->send(COMMAND_SET_RECOVERY, 0, average_recovery);
+				}
 
 				//A slider for the simulation speed. Bounds are between 0.0 and 5.0
-				ImGui::SliderFloat("Simulation Speed", &sim_speed, 0.0f, 5.0f);
+				if (ImGui::SliderFloat("Simulation Speed", &sim_speed, 0.0f, 5.0f)) {
+					simulation->send(COMMAND_SET_SPEED, 0, sim_speed);
+				}
+
+				//Runs as many ticks as the simulation thread can instead of following the speed slider
+				if (ImGui::Checkbox("As Fast As Possible", &uncapped)) {
+					simulation->send(COMMAND_SET_UNCAPPED, uncapped);
+				}
+
+				ImGui::Text("Ticks per second: %d", snapshot.ticks_per_second);
+
+				//The epidemic curve, in the same colors as the circles. Each line is cut down to a point per pixel across, so this
+				//costs the same every frame however long the run has gone on.
+				ImGui::Text("Susceptible %d  Infected %d  Recovered %d", snapshot.susceptible, snapshot.infected, snapshot.recovered);
+				{
+					const EpidemicCurve &curve = snapshot.curve;
+					ImVec2 corner = ImGui::GetCursorScreenPos();
+					ImVec2 size(max(ImGui::GetContentRegionAvail().x, 50.0f), 120.0f);
+					ImGui::Dummy(size);
+
+					ImDrawList *draw_list = ImGui::GetWindowDrawList();
+					draw_list->AddRectFilled(corner, ImVec2(corner.x + size.x, corner.y + size.y), IM_COL32(20, 20, 20, 255));
+
+					float first_tick = curve.firstTick();
+					float span = max(1.0f, curve.lastTick() - first_tick);
+					float population = max(1.0f, curve.population());
+					const unsigned char series_state[CURVE_SERIES] = { SUSCEPTIBLE, INFECTED, RECOVERED };
+
+					for (int series = 0;series < CURVE_SERIES;series++) {
+						curve.downsample((CurveSeries)series, (int)size.x, plot_ticks, plot_values);
+						plot_points.resize(plot_ticks.size());
+						for (int point = 0;point < plot_ticks.size();point++) {
+							plot_points[point].x = corner.x + (plot_ticks[point] - first_tick) / span * size.x;
+							plot_points[point].y = corner.y + size.y - plot_values[point] / population * size.y;
+						}
+
+						float color[3];
+						stateColor(series_state[series], color);
+						draw_list->AddPolyline(plot_points.data(), (int)plot_points.size(), ImGui::ColorConvertFloat4ToU32(ImVec4(color[0], color[1], color[2], 1.0f)), false, 1.5f);
+					}
+				}
+
+				//Times each part of the frame. Off by default, since looking at the timings costs a little every frame.
+				if (ImGui::Checkbox("Profile", &profiling)) {
+					setProfiling(profiling);
+				}
+				if (profiling) {
+					//The last whole frame, since this one isn't over yet. Blocks that ran more than once, or on several threads at
+					//once, are added together.
+					if (profileLatest("Frame", frame_events)) {
+						for (int event = 0;event < frame_events.size();event++) {
+							double total = 0.0;
+							bool first = true;
+							for (int other = 0;other < frame_events.size();other++) {
+								if (strcmp(frame_events[other].name, frame_events[event].name) == 0) {
+									first = first && other >= event;
+									total += frame_events[other].duration;
+								}
+							}
+							if (first) {
+								ImGui::Text("%-20s %8.3f ms", frame_events[event].name, total / 1e6);
+							}
+						}
+					}
+
+					//Saves everything still in the profiler's buffer next to the program
+					if (ImGui::Button("Save Trace")) {
+						trace_message = writeChromeTrace("trace.json") ? "Saved trace.json" : "Failed to save trace.json";
+					}
+					if (!trace_message.empty()) {
+						ImGui::SameLine();
+						ImGui::Text("%s", trace_message.c_str());
+					}
+				}
 				ImGui::End();
 			}
 
@@ -288,12 +377,19 @@ int main()
 		}
 
 		//Finished with rendering, display the image on the screen.
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		{
+			PROFILE_SCOPE("Swap buffers");
+			glfwSwapBuffers(window);
+		}
 	}
 
 	//Clean up nicely after ourselves, once everything is done.
 
+	//Stop the simulation before the window goes, since it wakes the window up, and the graphics card objects have to go while
+	//the window's context is still there
+	simulation.reset();
+	renderer.reset();
+
 	// imgui cleanup
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
@@ -303,8 +399,6 @@ int main()
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
-	//Variable cleanup
-	delete(circles);
 	return 0;
 }
 
@@ -359,276 +453,3 @@ void drawInSquareViewport(GLFWwindow *window)
 
 
 }
-
-void generateCircles(vector<Circle> &circles)
-{
-	//Defines the vertex data that I'd like to use using vector objects
-	vector<double> circle((NUM_CIRCLE_VERTICES + 2) * 3);
-	//The center is (0,0,0) since I'll use the vertex shader to define translations
-
-	//The angle as measured from (0,1,0) clockwise
-	double angle;
-
-	//Makes a ring of vertices to draw with TRIANGLEFAN
-	for (int i = 1;i < NUM_CIRCLE_VERTICES + 2;i++) {
-		angle = (i - 1) * (2 * PI) / NUM_CIRCLE_VERTICES;
-		circle[3 * i] = sin(angle);
-		circle[(3 * i) + 1] = cos(angle);
-	}
-
-
-	//Create a spot in memory for a Vertex Array Object. This will bind together all the calls necessary to send our data to the GPU and interpret it, so that it's easier to call later in the program
-	unsigned int VAO;
-
-	glGenVertexArrays(1, &VAO);
-
-	//Creates a spot in memory for a handle to the Vertex Buffer Object
-	unsigned int VBO;
-
-	//Creates the Vertex Buffer Object and stores the handle in the spot in memory that we specify
-	glGenBuffers(1, &VBO);
-
-	//Sets the Vertex Array Object, so that further calls describing the buffer and interpretation are stored within that instance.
-	glBindVertexArray(VAO);
-
-	//Binds the GL array buffer to the buffer object that we just created
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	//Sends the vertex data to the data buffer and tells it that we won't be changing this data often (which affects how the graphics card stores the data)
-	glBufferData(GL_ARRAY_BUFFER, circle.size() * sizeof(double), circle.data(), GL_STATIC_DRAW);
-
-	//Defines how to process the data we sent in
-	glVertexAttribPointer(0, 3, GL_DOUBLE, GL_FALSE, 3 * sizeof(double), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	//Now that we've finished making all of those definitions, tell OpenGL to stop writing things to those objects so that future statements don't accidentally modify them.
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	createCircles(circles, VAO);
-}
-
-void createCircles(vector<Circle> &circles, int VAO)
-{
-	vector<double> position(2);
-	vector<double> velocity(2);
-	vector<float> color(3);
-	double angle;
-	double max=RAND_MAX;
-
-	srand(time(NULL));
-
-	//Make the uninfected color blue
-	color[2] = 1.0;
-
-	for (int i = 0;i < circles.size();i++) {
-
-		//Calculate random position
-		position[0] = (rand() / max) * 2 - 1;
-		position[1] = (rand() / max) * 2 - 1;
-
-		//Create circle object
-		circles[i] = Circle(position, CIRCLE_RADIUS, VAO);
-
-		//Calculate random velocity angle
-		angle = (rand() / max) * 2 * PI;
-
-		//Calculate Cartesian components of velocity
-		velocity[0] = cos(angle);
-		velocity[1] = sin(angle);
-
-		//Set velocity result
-		circles[i].setVelocity(velocity);
-
-		//Set color to be uninfected;
-		circles[i].setColor(color);
-	}
-
-	//Check for circle overlap before the program starts
-	circleCollision(circles, false, 0.0, 0.0);
-
-	color[2] = 0.0;
-	color[0] = 1.0;
-
-	//Start an infection. Note that I've done this after the collision detection has already run once, so that any circles that were initially overlapping don't infect each other
-	circles[0].setColor(color);
-}
-
-void circleMotion(vector<Circle> &circles, bool immunity, float infection_chance, float average_recovery)
-{
-	circleCollision(circles, immunity, infection_chance, average_recovery);
-
-	vector<double> position;
-	vector<double> velocity;
-
-	for (int circle = 0;circle < circles.size();circle++) {
-		position = circles[circle].getPosition();
-		velocity = circles[circle].getVelocity();
-		position[0] = position[0] + velocity[0] * sim_speed * CIRCLE_SPEED;
-		position[1] = position[1] + velocity[1] * sim_speed * CIRCLE_SPEED;
-
-		circles[circle].setPosition(position);
-	}
-}
-
-void circleCollision(vector<Circle> &circles, bool immunity, float infection_chance, float average_recovery)
-{
-	vector<double> position(2);
-	vector<double> distance(2);
-	vector<double> velocity(2);
-	vector<double> other_velocity(2);
-	vector<float> red(3);
-	vector<float> green(3);
-	double radius;
-	double overlap;
-	double dot;
-	double magnitude;
-
-	double max = RAND_MAX;
-
-	red[0] = 1.0;
-	green[1] = 1.0;
-
-	for (int circle = 0;circle < circles.size();circle++) {
-
-		//Poll the current attributes of the circle of interest
-		position = circles[circle].getPosition();
-		velocity = circles[circle].getVelocity();
-		radius = circles[circle].getRadius();
-
-		//Check for collisions between circles. By starting the second loop after the current position of the first loop, I don't check for the same collision twice
-		for (int other_circle = circle+1;other_circle < circles.size();other_circle++) {
-
-			//Calculates vector between the two circles
-			distance[0] = position[0] - circles[other_circle].getPosition()[0];
-			distance[1] = position[1] - circles[other_circle].getPosition()[1];
-
-			//The magnitude of the distance vector
-			magnitude = sqrt(distance[0] * distance[0] + distance[1] * distance[1]);
-
-			//The amount of overlap between the two circles
-			overlap = (circles[circle].getRadius() + circles[other_circle].getRadius())-magnitude;
-				
-			//Rounding error is in the 1e-17 spot, so this avoids weird rounding errors that might not shift the circles quite all of the way out of each other
-			if (overlap>1e-16) {
-				//Poll the velocity of the other circle
-				other_velocity = circles[other_circle].getVelocity();
-
-				//Convert the displacement vector to a unit vector
-				distance[0] = distance[0] / magnitude;
-				distance[1] = distance[1] / magnitude;
-
-				//Shift the position to avoid clipping
-				position[0] = position[0] + distance[0] * overlap;
-				position[1] = position[1] + distance[1] * overlap;
-
-				//Compute the dot product between the velocity and the normal vector to the plane of incidence
-				dot = velocity[0] * (-distance[0]) + velocity[1] * (-distance[1]);
-
-				//Adjust the velocity using the reflection formula
-				velocity[0] = velocity[0] - 2 * dot * (-distance[0]);
-				velocity[1] = velocity[1] - 2 * dot * (-distance[1]);
-
-				//Compute the dot product between the other velocity and the normal vector to the plane of incidence
-				dot = other_velocity[0] * distance[0] + other_velocity[1] * distance[1];
-
-				//Adjust the other velocity using the reflection formula
-				other_velocity[0] = other_velocity[0] - 2 * dot * distance[0];
-				other_velocity[1] = other_velocity[1] - 2 * dot * distance[1];
-
-				//Set the velocity for the other circle
-				circles[other_circle].setVelocity(other_velocity);
-
-				//Check for infection transmission
-				if ((circles[circle].getColor()[0] + circles[other_circle].getColor()[0] == 1.0)) {
-					if (rand() / max < infection_chance) {
-						if (immunity) {
-							//No chance of reinfection
-							if (circles[circle].getColor() != green) {
-								circles[circle].setColor(red);
-							}
-							if (circles[other_circle].getColor() != green) {
-								circles[other_circle].setColor(red);
-							}
-						}
-						else {
-							circles[circle].setColor(red);
-							circles[other_circle].setColor(red);
-						}
-					}
-				}
-			}
-			
-		}
-
-
-		//Checks for collisions between the circles and the sides of the screen
-		//I've intentionally put this last, as I want the circles to stay inside the screen more than I care about them slightly clipping into each other
-		if (position[0] < -1.0 + radius) {
-			position[0] = -1.0 + radius;
-			velocity[0] = -velocity[0];
-		}else if (position[0] > 1.0 - radius) {
-			position[0] = 1.0 - radius;
-			velocity[0] = -velocity[0];
-		}
-
-		if (position[1] < -1.0 + radius) {
-			position[1] = -1.0 + radius;
-			velocity[1] = -velocity[1];
-		}else if (position[1] > 1.0 - radius) {
-			position[1] = 1.0 - radius;
-			velocity[1] = -velocity[1];
-		}
-
-		//Set the circle attributes as calculated
-		circles[circle].setPosition(position);
-		circles[circle].setVelocity(velocity);
-
-		//Check for recovered
-		if ((circles[circle].getColor() == red) && rand() / max < 1 / (average_recovery * FRAMERATE) * sim_speed) {
-			circles[circle].setColor(green);
-		}
-
-	}
-}
-
-void drawCircles(vector<Circle> &circles, int shaderProgram) {
-	//Generate the model matrix for movement around the screen (i.e. the coordinates of where my object origin should reside)
-	//Initialize to the identity matrix to be modified by later object calls
-	float model_matrix[4][4];
-	
-	for (int circle = 0;circle < circles.size();circle++) {
-		//Reset model matrix to the identity matrix
-		for (int i = 0;i < 4;i++) {
-			for (int j = 0;j < 4; j++) {
-				if (i == j) {
-					model_matrix[i][j] = 1.0;
-				}
-				else {
-					model_matrix[i][j] = 0.0;
-				}
-			}
-		}
-
-		//Tells OpenGL how to get the data properly transmitted
-		glBindVertexArray(circles[circle].getVertexData());
-
-		//Update the model matrix
-		for (int i = 0;i < 3;i++) {
-			model_matrix[i][i] = (float)circles[circle].getRadius();
-		}
-		model_matrix[3][0] = (float)circles[circle].getPosition()[0];
-		model_matrix[3][1] = (float)circles[circle].getPosition()[1];
-
-		//Pass the Model/View matrix into the shader
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "mvMatrix"), 1, GL_FALSE, *model_matrix);
-
-		//Pass the color from the circle object into the shader
-		glUniform3fv(glGetUniformLocation(shaderProgram, "color"), 1, circles[circle].getColor().data());
-
-
-		//Draw the circle. Yay!
-		glDrawArrays(GL_TRIANGLE_FAN, 0, NUM_CIRCLE_VERTICES + 2);
-	}
-
-}
\ No newline at end of file
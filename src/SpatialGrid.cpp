@@ -0,0 +1,178 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid()
+{
+	cell_size = 2.0;
+	cells_per_side = 1;
+}
+
+//Converts a coordinate in [-1,1] into a row or column of the grid. Circles can drift slightly outside of the screen between the
+//motion and collision steps, so anything out of range is put in the nearest edge cell.
+int SpatialGrid::cellCoordinate(double position)
+{
+	int coordinate = int(floor((position + 1.0) / cell_size));
+	if (coordinate < 0)
+		return 0;
+	if (coordinate >= cells_per_side)
+		return cells_per_side - 1;
+	return coordinate;
+}
+
+//Sorts the circles into cells. The work is split into "tasks" pieces for the pool, but the result is always exactly the same as
+//doing it on one thread: every cell lists its circles in increasing index order. The cells are made wider by skin, so that
+//circles closer than their radii plus the skin are still always in cells next to each other.
+void SpatialGrid::rebuild(AgentStore &circles, ThreadPool &pool, int tasks, double skin)
+{
+	int count = circles.size();
+
+	//Two circles can only touch if their centers are closer than the sum of their radii, so make the cells one diameter wide.
+	//Every circle currently uses CIRCLE_RADIUS, but taking the largest radius keeps this correct if that ever changes.
+	double max_radius = 0.0;
+	for (int circle = 0;circle < count;circle++) {
+		max_radius = max(max_radius, circles.radius[circle]);
+	}
+	cell_size = max(2.0 * max_radius + skin, 1e-6);
+	cells_per_side = max(1, int(ceil(2.0 / cell_size)));
+
+	//With very small circles that would be far more cells than circles, and clearing and scanning empty cells starts to cost more
+	//than it saves. Cap it at a few cells per circle by making the cells bigger, which is always safe.
+	int max_cells_per_side = 2 * max(1, int(ceil(sqrt((double)count))));
+	if (cells_per_side > max_cells_per_side) {
+		cells_per_side = max_cells_per_side;
+		cell_size = 2.0 / cells_per_side;
+	}
+
+	int num_cells = cells_per_side * cells_per_side;
+
+	//The circles are split into blocks of consecutive indices, and the grid into bands of rows
+	int blocks = max(1, min(tasks, count));
+	int bands = max(1, min(tasks, cells_per_side));
+
+	row_band.resize(cells_per_side);
+	for (int band = 0;band < bands;band++) {
+		for (int row = cells_per_side * band / bands;row < cells_per_side * (band + 1) / bands;row++) {
+			row_band[row] = band;
+		}
+	}
+
+	//Step one: work out each circle's cell, and count how many circles each block sends to each band
+	circle_cell.resize(count);
+	block_band_slot.assign(blocks * bands, 0);
+	pool.run(blocks, [&](int block) {
+		for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+			int cell = findCell(circles.x[circle], circles.y[circle]);
+			circle_cell[circle] = cell;
+			block_band_slot[block * bands + row_band[cell / cells_per_side]]++;
+		}
+	});
+
+	//Step two: turn the counts into where each block starts writing inside each band. Bands are laid out one after another.
+	band_start.resize(bands + 1);
+	int offset = 0;
+	for (int band = 0;band < bands;band++) {
+		band_start[band] = offset;
+		for (int block = 0;block < blocks;block++) {
+			int block_count = block_band_slot[block * bands + band];
+			block_band_slot[block * bands + band] = offset;
+			offset += block_count;
+		}
+	}
+	band_start[bands] = offset;
+
+	//Step three: every block drops its circles into their bands. Blocks write to separate slots in increasing index order, so
+	//each band ends up sorted by index.
+	band_entries.resize(count);
+	pool.run(blocks, [&](int block) {
+		for (int circle = count * block / blocks;circle < count * (block + 1) / blocks;circle++) {
+			band_entries[block_band_slot[block * bands + row_band[circle_cell[circle] / cells_per_side]]++] = circle;
+		}
+	});
+
+	//Step four: each band does a counting sort of its own circles by cell. The cells in a band are a continuous range, and the
+	//band's circles fill a continuous range of cell_entries, so bands never touch each other's memory.
+	cell_start.resize(num_cells + 1);
+	next_slot.resize(num_cells);
+	cell_entries.resize(count);
+	pool.run(bands, [&](int band) {
+		int first_cell = (cells_per_side * band / bands) * cells_per_side;
+		int last_cell = (cells_per_side * (band + 1) / bands) * cells_per_side;
+
+		//Count how many circles are in each cell...
+		for (int cell = first_cell;cell < last_cell;cell++) {
+			cell_start[cell] = 0;
+		}
+		for (int entry = band_start[band];entry < band_start[band + 1];entry++) {
+			cell_start[circle_cell[band_entries[entry]]]++;
+		}
+
+		//...then turn the counts into starting offsets...
+		int start = band_start[band];
+		for (int cell = first_cell;cell < last_cell;cell++) {
+			int cell_count = cell_start[cell];
+			cell_start[cell] = start;
+			next_slot[cell] = start;
+			start += cell_count;
+		}
+
+		//...and finally drop each circle into its slot. Going through the circles in order keeps each cell sorted by index.
+		for (int entry = band_start[band];entry < band_start[band + 1];entry++) {
+			int circle = band_entries[entry];
+			cell_entries[next_slot[circle_cell[circle]]++] = circle;
+		}
+	});
+	cell_start[num_cells] = count;
+}
+
+int SpatialGrid::findCell(double x, double y)
+{
+	return cellCoordinate(y) * cells_per_side + cellCoordinate(x);
+}
+
+//Collects every circle with a higher index than "after" that sits in the same cell as the point (x,y) or a cell next to it.
+//They come out grouped by cell, not sorted by index.
+void SpatialGrid::findNeighbours(double x, double y, int after, vector<int> &neighbours)
+{
+	neighbours.clear();
+
+	int row = cellCoordinate(y);
+	int column = cellCoordinate(x);
+
+	for (int other_row = max(0, row - 1);other_row <= min(cells_per_side - 1, row + 1);other_row++) {
+		for (int other_column = max(0, column - 1);other_column <= min(cells_per_side - 1, column + 1);other_column++) {
+			int cell = other_row * cells_per_side + other_column;
+			for (int entry = cell_start[cell];entry < cell_start[cell + 1];entry++) {
+				if (cell_entries[entry] > after) {
+					neighbours.push_back(cell_entries[entry]);
+				}
+			}
+		}
+	}
+}
+
+//The circles in a cell are cellEntry(cellBegin(cell)) up to, but not including, cellEntry(cellEnd(cell))
+int SpatialGrid::cellBegin(int cell)
+{
+	return cell_start[cell];
+}
+
+int SpatialGrid::cellEnd(int cell)
+{
+	return cell_start[cell + 1];
+}
+
+int SpatialGrid::cellEntry(int entry)
+{
+	return cell_entries[entry];
+}
+
+double SpatialGrid::getCellSize()
+{
+	return cell_size;
+}
+
+int SpatialGrid::getCellsPerSide()
+{
+	return cells_per_side;
+}
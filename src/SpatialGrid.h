@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "AgentStore.h"
+#include "ThreadPool.h"
+using namespace std;
+
+//A uniform grid laid over the [-1,1] x [-1,1] viewing area. Each circle is binned into the cell that contains its center, so a
+//circle can only ever touch circles in its own cell or the eight cells around it. This replaces checking every pair of circles.
+class SpatialGrid
+{
+	double cell_size;
+	int cells_per_side;
+
+	//Index into cell_entries where each cell starts. Cell c owns the entries from cell_start[c] up to cell_start[c+1]
+	vector<int> cell_start;
+	//Circle indices sorted by cell. Within a cell they stay in increasing order.
+	vector<int> cell_entries;
+	//The cell each circle was binned into on the last rebuild
+	vector<int> circle_cell;
+	//Scratch space for the counting sort. The circles are first split into bands of rows, then sorted by cell within each band.
+	vector<int> next_slot;
+	vector<int> row_band;
+	vector<int> band_start;
+	vector<int> band_entries;
+	vector<int> block_band_slot;
+
+	int cellCoordinate(double position);
+
+public:
+	SpatialGrid();
+	void rebuild(AgentStore &circles, ThreadPool &pool, int tasks, double skin = 0.0);
+	int findCell(double x, double y);
+	void findNeighbours(double x, double y, int after, vector<int> &neighbours);
+	int cellBegin(int cell);
+	int cellEnd(int cell);
+	int cellEntry(int entry);
+	double getCellSize();
+	int getCellsPerSide();
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+//A fixed size queue for handing things from exactly one thread to exactly one other thread without locks. The producer only
+//ever moves the tail and the consumer only ever moves the head, so neither can block the other. Pushing onto a full queue and
+//popping from an empty one fail straight away instead of waiting; it's up to the caller what to do about it.
+template <class T>
+class SpscQueue
+{
+	vector<T> slots;
+	size_t mask;
+
+	//On separate cache lines so the two threads don't keep stealing the line from each other
+	alignas(64) atomic<size_t> head;
+	alignas(64) atomic<size_t> tail;
+
+public:
+	//The capacity is rounded up to a power of two
+	SpscQueue(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity) {
+			size *= 2;
+		}
+		slots.resize(size);
+		mask = size - 1;
+		head = 0;
+		tail = 0;
+	}
+
+	//Producer only. Returns false if the queue is full.
+	bool push(const T &item)
+	{
+		size_t position = tail.load(memory_order_relaxed);
+		if (position - head.load(memory_order_acquire) == slots.size()) {
+			return false;
+		}
+		slots[position & mask] = item;
+		tail.store(position + 1, memory_order_release);
+		return true;
+	}
+
+	//Consumer only. Whether there's nothing to pop right now.
+	bool empty()
+	{
+		return head.load(memory_order_relaxed) == tail.load(memory_order_acquire);
+	}
+
+	//Consumer only. Returns false if the queue is empty.
+	bool pop(T &item)
+	{
+		size_t position = head.load(memory_order_relaxed);
+		if (position == tail.load(memory_order_acquire)) {
+			return false;
+		}
+		item = slots[position & mask];
+		head.store(position + 1, memory_order_release);
+		return true;
+	}
+};
@@ -0,0 +1,427 @@
+#include "Sweep.h"
+
+//Reading the journal and the specifications
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+//Sampling the Latin hypercube
+#include "Random.h"
+
+//Significant digits written for every result, enough that reading a journal back and writing it out again gives the same text
+#define RESULT_PRECISION 10
+
+static const char *result_header = "point,num_circles,infection_chance,average_recovery,immunity,replicas,"
+	"mean_final_susceptible,mean_final_recovered,sd_final_recovered,mean_peak_infected,mean_peak_tick,mean_duration";
+
+ParameterSweep::ParameterSweep(const ModelParameters &base)
+{
+	this->base = base;
+}
+
+//Sets one of the swept parameters on a point. Returns false for a name that can't be swept.
+bool ParameterSweep::setParameter(ModelParameters &point, const string &name, double value)
+{
+	if (name == "num_circles" || name == "agents") {
+		point.agents = (int)floor(value + 0.5);
+	}
+	else if (name == "infection_chance") {
+		point.infection_chance = (float)value;
+	}
+	else if (name == "average_recovery") {
+		point.average_recovery = (float)value;
+	}
+	else if (name == "immunity") {
+		point.immunity = value != 0.0;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+//Whether the model can be run at a point. Returns false and says which parameter is out of range if it can't.
+bool ParameterSweep::checkPoint(const ModelParameters &point, string &error)
+{
+	if (point.agents < 1) {
+		error = "The number of agents must be at least 1";
+		return false;
+	}
+	if (!(point.infection_chance >= 0.0f && point.infection_chance <= 1.0f)) {
+		error = "The infection chance must be between 0 and 1";
+		return false;
+	}
+	if (!(point.average_recovery > 0.0f)) {
+		error = "The average recovery time must be positive";
+		return false;
+	}
+	return true;
+}
+
+//Reads a specification like "infection_chance=0.1:1:10" or "immunity=0,1"
+bool ParameterSweep::addParameter(const string &specification, string &error)
+{
+	size_t equals = specification.find('=');
+	if (equals == string::npos) {
+		error = "Expected name=values in \"" + specification + "\"";
+		return false;
+	}
+
+	SweepParameter parameter;
+	parameter.name = specification.substr(0, equals);
+	string values = specification.substr(equals + 1);
+
+	ModelParameters check;
+	if (!setParameter(check, parameter.name, 0.0)) {
+		error = "Can't sweep \"" + parameter.name + "\". Use num_circles, infection_chance, average_recovery or immunity.";
+		return false;
+	}
+
+	char separator = values.find(':') != string::npos ? ':' : ',';
+	stringstream fields(values);
+	string field;
+	vector<double> numbers;
+	while (getline(fields, field, separator)) {
+		char *end;
+		numbers.push_back(strtod(field.c_str(), &end));
+		if (field.empty() || *end != '\0' || !isfinite(numbers.back())) {
+			error = "\"" + field + "\" isn't a number in \"" + specification + "\"";
+			return false;
+		}
+	}
+
+	parameter.is_range = separator == ':';
+	if (parameter.is_range) {
+		if (numbers.size() < 2 || numbers.size() > 3 || numbers[1] < numbers[0]) {
+			error = "A range is low:high or low:high:steps in \"" + specification + "\"";
+			return false;
+		}
+		parameter.low = numbers[0];
+		parameter.high = numbers[1];
+		parameter.steps = numbers.size() == 3 ? (int)numbers[2] : 0;
+
+		//The values the grid uses
+		for (int step = 0;step < parameter.steps;step++) {
+			parameter.values.push_back(parameter.steps == 1 ? parameter.low : parameter.low + step * (parameter.high - parameter.low) / (parameter.steps - 1));
+		}
+	}
+	else {
+		if (numbers.empty()) {
+			error = "No values in \"" + specification + "\"";
+			return false;
+		}
+		parameter.values = numbers;
+		parameter.low = *min_element(numbers.begin(), numbers.end());
+		parameter.high = *max_element(numbers.begin(), numbers.end());
+		parameter.steps = (int)numbers.size();
+	}
+
+	//Every value the parameter can take lies between its ends, so checking those covers them all
+	double ends[2] = { parameter.low, parameter.high };
+	for (int end = 0;end < 2;end++) {
+		ModelParameters point;
+		setParameter(point, parameter.name, ends[end]);
+		if (!checkPoint(point, error)) {
+			error += " in \"" + specification + "\"";
+			return false;
+		}
+	}
+
+	parameters.push_back(parameter);
+	return true;
+}
+
+//Every combination of the parameters' values. The first parameter changes slowest.
+bool ParameterSweep::buildGrid(string &error)
+{
+	points.clear();
+
+	int total = 1;
+	for (int parameter = 0;parameter < parameters.size();parameter++) {
+		if (parameters[parameter].values.empty()) {
+			error = "The grid needs a number of steps for " + parameters[parameter].name + " (low:high:steps)";
+			return false;
+		}
+		total *= (int)parameters[parameter].values.size();
+	}
+
+	for (int index = 0;index < total;index++) {
+		ModelParameters point = base;
+		int remainder = index;
+		for (int parameter = (int)parameters.size() - 1;parameter >= 0;parameter--) {
+			int count = (int)parameters[parameter].values.size();
+			setParameter(point, parameters[parameter].name, parameters[parameter].values[remainder % count]);
+			remainder /= count;
+		}
+		if (!checkPoint(point, error)) {
+			error += " at point " + to_string(index);
+			return false;
+		}
+		points.push_back(point);
+	}
+	return true;
+}
+
+//Spreads the given number of samples so that, for every parameter on its own, each of the samples lands in a different one of
+//that many equal slices of its range. Lists of values are sliced the same way, by position in the list.
+bool ParameterSweep::buildLatinHypercube(int samples, unsigned long long seed, string &error)
+{
+	if (samples < 1) {
+		error = "A Latin hypercube needs at least one sample";
+		return false;
+	}
+
+	points.assign(samples, base);
+	vector<int> slices(samples);
+
+	for (int parameter = 0;parameter < parameters.size();parameter++) {
+		const SweepParameter &sweep = parameters[parameter];
+
+		//Shuffle which slice each sample gets
+		for (int sample = 0;sample < samples;sample++) {
+			slices[sample] = sample;
+		}
+		for (int sample = samples - 1;sample > 0;sample--) {
+			int other = (int)(randomUniform(seed, 0, sample, parameter, RANDOM_SAMPLING) * (sample + 1));
+			swap(slices[sample], slices[other]);
+		}
+
+		for (int sample = 0;sample < samples;sample++) {
+			//Where in [0,1) the sample lands, somewhere random inside its slice
+			double position = (slices[sample] + randomUniform(seed, 1, sample, parameter, RANDOM_SAMPLING)) / samples;
+			double value;
+			if (sweep.is_range) {
+				value = sweep.low + position * (sweep.high - sweep.low);
+			}
+			else {
+				value = sweep.values[min((int)sweep.values.size() - 1, (int)(position * sweep.values.size()))];
+			}
+			setParameter(points[sample], sweep.name, value);
+		}
+	}
+
+	for (int sample = 0;sample < samples;sample++) {
+		if (!checkPoint(points[sample], error)) {
+			error += " at point " + to_string(sample);
+			return false;
+		}
+	}
+	return true;
+}
+
+int ParameterSweep::getPoints()
+{
+	return (int)points.size();
+}
+
+//Identifies a sweep by everything that affects its results, so a journal from a different sweep is never mixed in. It's an
+//FNV-1a hash of the settings and the exact value of every point.
+string ParameterSweep::signature(int replicas, unsigned long long seed)
+{
+	ostringstream settings;
+	settings << setprecision(17) << base.max_ticks << "," << base.radius << "," << base.sim_speed << "," << replicas << "," << seed;
+	for (int point = 0;point < points.size();point++) {
+		settings << ";" << points[point].agents << "," << points[point].infection_chance << "," << points[point].average_recovery << "," << points[point].immunity;
+	}
+
+	unsigned long long hash = 14695981039346656037ull;
+	string text = settings.str();
+	for (int character = 0;character < text.size();character++) {
+		hash = (hash ^ (unsigned char)text[character]) * 1099511628211ull;
+	}
+
+	ostringstream result;
+	result << "sweep points=" << points.size() << " replicas=" << replicas << " seed=" << seed << " hash=" << hex << hash;
+	return result.str();
+}
+
+//Reads back the points a previous run of the same sweep finished. Returns false if the journal is from a different sweep.
+bool ParameterSweep::resume(const string &journal_path, const string &expected_signature, int replicas, string &error)
+{
+	ifstream input(journal_path.c_str(), ios::binary);
+	if (!input.good()) {
+		return true;
+	}
+
+	//An empty journal is the same as none
+	string line;
+	if (!getline(input, line)) {
+		return true;
+	}
+	if (line != "# " + expected_signature) {
+		error = journal_path + " is from a different sweep. Delete it or pick another journal to start over.";
+		return false;
+	}
+
+	//Skip the header
+	getline(input, line);
+
+	while (getline(input, line)) {
+		vector<string> fields;
+		stringstream columns(line);
+		string field;
+		while (getline(columns, field, ',')) {
+			fields.push_back(field);
+		}
+
+		//A line cut short by the interruption is simply run again
+		if (fields.size() != 12) {
+			continue;
+		}
+		int point = atoi(fields[0].c_str());
+		if (point < 0 || point >= points.size() || atoi(fields[5].c_str()) != replicas) {
+			continue;
+		}
+
+		SweepResult &result = results[point];
+		result.mean_final_susceptible = atof(fields[6].c_str());
+		result.mean_final_recovered = atof(fields[7].c_str());
+		result.sd_final_recovered = atof(fields[8].c_str());
+		result.mean_peak_infected = atof(fields[9].c_str());
+		result.mean_peak_tick = atof(fields[10].c_str());
+		result.mean_duration = atof(fields[11].c_str());
+		finished[point] = true;
+	}
+	return true;
+}
+
+//Runs every replica of every point that isn't already in the journal
+bool ParameterSweep::run(ThreadPool &pool, int replicas, unsigned long long seed, const string &journal_path, string &error)
+{
+	results.assign(points.size(), SweepResult());
+	finished.assign(points.size(), false);
+	replicas_left.assign(points.size(), replicas);
+	replica_results.assign(points.size() * replicas, ReplicaResult());
+
+	string expected_signature = signature(replicas, seed);
+	if (!resume(journal_path, expected_signature, replicas, error)) {
+		return false;
+	}
+
+	//Start a new journal, or carry on with the old one. If the old one was cut off partway through a line, finish that line so
+	//new rows start on their own.
+	bool new_journal;
+	bool needs_newline = false;
+	{
+		ifstream existing(journal_path.c_str(), ios::binary | ios::ate);
+		new_journal = !existing.good() || existing.tellg() == 0;
+		if (!new_journal) {
+			existing.seekg(-1, ios::end);
+			needs_newline = existing.get() != '\n';
+		}
+	}
+	journal.open(journal_path.c_str(), ios::app | ios::binary);
+	if (!journal) {
+		error = "Failed to open " + journal_path;
+		return false;
+	}
+	journal << setprecision(RESULT_PRECISION);
+	if (new_journal) {
+		journal << "# " << expected_signature << "\n" << result_header << "\n";
+	}
+	else if (needs_newline) {
+		journal << "\n";
+	}
+	journal.flush();
+
+	vector<int> pending;
+	for (int point = 0;point < points.size();point++) {
+		if (!finished[point]) {
+			pending.push_back(point);
+		}
+	}
+
+	//Task t is replica t % replicas of the (t / replicas)th pending point, so points tend to finish in order
+	pool.run((int)pending.size() * replicas, [&](int task) {
+		static thread_local vector<int> trajectory;
+		int point = pending[task / replicas];
+		int replica = task % replicas;
+
+		runReplica(points[point], seed + replica, trajectory);
+
+		ReplicaResult &result = replica_results[(size_t)point * replicas + replica];
+		int length = (int)trajectory.size() / COMPARTMENT_COUNT;
+		result.final_susceptible = trajectory[(length - 1) * COMPARTMENT_COUNT + COMPARTMENT_SUSCEPTIBLE];
+		result.final_recovered = trajectory[(length - 1) * COMPARTMENT_COUNT + COMPARTMENT_RECOVERED];
+		result.peak_infected = 0;
+		result.peak_tick = 0;
+		for (int tick = 0;tick < length;tick++) {
+			if (trajectory[tick * COMPARTMENT_COUNT + COMPARTMENT_INFECTED] > result.peak_infected) {
+				result.peak_infected = trajectory[tick * COMPARTMENT_COUNT + COMPARTMENT_INFECTED];
+				result.peak_tick = tick;
+			}
+		}
+		result.duration = length - 1;
+
+		unique_lock<mutex> guard(lock);
+		replicas_left[point]--;
+		if (replicas_left[point] == 0) {
+			finishPoint(point, replicas);
+		}
+	});
+
+	journal.close();
+	return true;
+}
+
+//Combines the replicas of a point in replica order and records it in the journal. Called with the lock held.
+void ParameterSweep::finishPoint(int point, int replicas)
+{
+	const ReplicaResult *replica_result = &replica_results[(size_t)point * replicas];
+	SweepResult &result = results[point];
+
+	double final_susceptible = 0.0;
+	double final_recovered = 0.0;
+	double final_recovered_squared = 0.0;
+	double peak_infected = 0.0;
+	double peak_tick = 0.0;
+	double duration = 0.0;
+	for (int replica = 0;replica < replicas;replica++) {
+		final_susceptible += replica_result[replica].final_susceptible;
+		final_recovered += replica_result[replica].final_recovered;
+		final_recovered_squared += (double)replica_result[replica].final_recovered * replica_result[replica].final_recovered;
+		peak_infected += replica_result[replica].peak_infected;
+		peak_tick += replica_result[replica].peak_tick;
+		duration += replica_result[replica].duration;
+	}
+
+	result.mean_final_susceptible = final_susceptible / replicas;
+	result.mean_final_recovered = final_recovered / replicas;
+	result.sd_final_recovered = replicas > 1 ? sqrt(max(0.0, (final_recovered_squared - final_recovered * final_recovered / replicas) / (replicas - 1))) : 0.0;
+	result.mean_peak_infected = peak_infected / replicas;
+	result.mean_peak_tick = peak_tick / replicas;
+	result.mean_duration = duration / replicas;
+	finished[point] = true;
+
+	//Flushed straight away, so the point survives the program being stopped
+	writeRow(journal, point, replicas);
+	journal.flush();
+}
+
+void ParameterSweep::writeRow(ostream &output, int point, int replicas)
+{
+	const ModelParameters &parameters = points[point];
+	const SweepResult &result = results[point];
+	//The parameters are floats, so they only get as many digits as a float holds
+	output << setprecision(7) << point << "," << parameters.agents << "," << parameters.infection_chance << "," << parameters.average_recovery << "," << (int)parameters.immunity << ","
+		<< setprecision(RESULT_PRECISION) << replicas << "," << result.mean_final_susceptible << "," << result.mean_final_recovered << "," << result.sd_final_recovered << ","
+		<< result.mean_peak_infected << "," << result.mean_peak_tick << "," << result.mean_duration << "\n";
+}
+
+//Writes one row per point, in point order. Returns false if the file couldn't be written.
+bool ParameterSweep::writeResults(const string &path, int replicas)
+{
+	ofstream output(path.c_str());
+	if (!output) {
+		return false;
+	}
+	output << setprecision(RESULT_PRECISION) << result_header << "\n";
+	for (int point = 0;point < points.size();point++) {
+		if (finished[point]) {
+			writeRow(output, point, replicas);
+		}
+	}
+	return output.good();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include "Ensemble.h"
+using namespace std;
+
+//One parameter being swept. It's either a list of values ("immunity=0,1") or a range ("infection_chance=0.1:1:10", from 0.1 to
+//1 in 10 even steps). For a Latin hypercube the number of steps in a range is ignored, since the samples decide the spacing.
+struct SweepParameter
+{
+	string name;
+	vector<double> values;
+	bool is_range;
+	double low;
+	double high;
+	int steps;
+};
+
+//What came out of all of the replicas at one point
+struct SweepResult
+{
+	double mean_final_susceptible;
+	double mean_final_recovered;
+	double sd_final_recovered;
+	double mean_peak_infected;
+	double mean_peak_tick;
+	double mean_duration;
+};
+
+//Runs the model over a set of parameter points, several replicas per point, and writes one row per point. Every (point, replica)
+//pair is its own task on the pool. Replica r uses seed + r at every point, so differences between points come from the parameters
+//rather than from luck of the draw.
+//
+//Finished points are appended to a journal file as they complete. If a sweep is interrupted, running it again with the same
+//settings reads the journal back and only runs the points that are missing.
+class ParameterSweep
+{
+	ModelParameters base;
+	vector<SweepParameter> parameters;
+	vector<ModelParameters> points;
+
+	//Per replica results, kept until every replica of a point is done so they can be combined in replica order
+	struct ReplicaResult
+	{
+		int final_susceptible;
+		int final_recovered;
+		int peak_infected;
+		int peak_tick;
+		int duration;
+	};
+	vector<ReplicaResult> replica_results;
+	//How many replicas of each point haven't finished yet, and whether the point is done, either this run or a previous one
+	vector<int> replicas_left;
+	vector<SweepResult> results;
+	vector<bool> finished;
+
+	//Guards the counts above and the journal
+	ofstream journal;
+	mutex lock;
+
+	bool setParameter(ModelParameters &point, const string &name, double value);
+	bool checkPoint(const ModelParameters &point, string &error);
+	string signature(int replicas, unsigned long long seed);
+	bool resume(const string &journal_path, const string &expected_signature, int replicas, string &error);
+	void finishPoint(int point, int replicas);
+	void writeRow(ostream &output, int point, int replicas);
+
+public:
+	ParameterSweep(const ModelParameters &base);
+	bool addParameter(const string &specification, string &error);
+	bool buildGrid(string &error);
+	bool buildLatinHypercube(int samples, unsigned long long seed, string &error);
+	int getPoints();
+	bool run(ThreadPool &pool, int replicas, unsigned long long seed, const string &journal_path, string &error);
+	bool writeResults(const string &path, int replicas);
+};
@@ -0,0 +1,149 @@
+//Runs the contact model over a grid or a Latin hypercube of parameter values, several replicas at each point, and writes a table
+//with one row per point. Long sweeps can be stopped and started again: finished points are kept in a journal and skipped on the
+//next run with the same settings.
+
+//Allows output messages
+#include <iostream>
+
+//Command line parsing
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//Timing of the run
+#include <chrono>
+
+//The sweep itself
+#include "Sweep.h"
+
+using namespace std;
+
+void printUsage();
+
+int main(int argc, char **argv)
+{
+	ModelParameters base;
+	vector<string> specifications;
+	int samples = 0;
+	int replicas = 100;
+	unsigned long long seed = 1;
+	int threads = 0;
+	string output_path = "sweep.csv";
+	string journal_path;
+
+	//Read the parameters from the command line
+	for (int arg = 1;arg < argc;arg++) {
+		//Every option except the flags takes a value after it
+		bool has_value = arg + 1 < argc;
+
+		if (strcmp(argv[arg], "--sweep") == 0 && has_value) {
+			specifications.push_back(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--latin-hypercube") == 0 && has_value) {
+			samples = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--replicas") == 0 && has_value) {
+			replicas = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--agents") == 0 && has_value) {
+			base.agents = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--ticks") == 0 && has_value) {
+			base.max_ticks = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--radius") == 0 && has_value) {
+			base.radius = atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--speed") == 0 && has_value) {
+			base.sim_speed = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--infection-chance") == 0 && has_value) {
+			base.infection_chance = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--recovery") == 0 && has_value) {
+			base.average_recovery = (float)atof(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--seed") == 0 && has_value) {
+			seed = strtoull(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--threads") == 0 && has_value) {
+			threads = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--output") == 0 && has_value) {
+			output_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--journal") == 0 && has_value) {
+			journal_path = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "--no-immunity") == 0) {
+			base.immunity = false;
+		}
+		else {
+			printUsage();
+			return strcmp(argv[arg], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (replicas < 1 || base.max_ticks < 0 || base.radius <= 0.0) {
+		cout << "The number of replicas and the radius must be positive" << endl;
+		return 1;
+	}
+	if (journal_path.empty()) {
+		journal_path = output_path + ".journal";
+	}
+
+	string error;
+	ParameterSweep sweep(base);
+	for (int specification = 0;specification < specifications.size();specification++) {
+		if (!sweep.addParameter(specifications[specification], error)) {
+			cout << error << endl;
+			return 1;
+		}
+	}
+	if (samples > 0 ? !sweep.buildLatinHypercube(samples, seed, error) : !sweep.buildGrid(error)) {
+		cout << error << endl;
+		return 1;
+	}
+
+	//Every replica runs its own simulation on a single thread, and the pool spreads the replicas out
+	setSimulationThreads(1);
+	ThreadPool pool(threads);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (!sweep.run(pool, replicas, seed, journal_path, error)) {
+		cout << error << endl;
+		return 1;
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (!sweep.writeResults(output_path, replicas)) {
+		cout << "Failed to write " << output_path << endl;
+		return 1;
+	}
+
+	cout << "Points: " << sweep.getPoints() << " x " << replicas << " replicas in " << seconds << " s" << endl
+		<< "Results written to " << output_path << " (journal: " << journal_path << ")" << endl;
+
+	return 0;
+}
+
+void printUsage()
+{
+	cout << "Usage: SweepRunner --sweep name=values [--sweep ...] [options]" << endl
+		<< "  --sweep name=values    a parameter to sweep: num_circles, infection_chance, average_recovery or immunity." << endl
+		<< "                         values are a list (immunity=0,1) or a range low:high:steps (infection_chance=0.1:1:10)" << endl
+		<< "  --latin-hypercube N    take N Latin hypercube samples instead of every combination (ranges are low:high)" << endl
+		<< "  --replicas N           replicas per point (default 100)" << endl
+		<< "  --agents N             number of circles/people where it isn't swept (default 30)" << endl
+		<< "  --ticks N              maximum number of ticks per replica (default 10000)" << endl
+		<< "  --radius R             circle radius, the screen is 2 units wide (default 0.05)" << endl
+		<< "  --speed S              simulation speed multiplier (default 1)" << endl
+		<< "  --infection-chance P   chance of infection per contact where it isn't swept (default 1.0)" << endl
+		<< "  --recovery T           average recovery time where it isn't swept (default 5.0)" << endl
+		<< "  --no-immunity          allow reinfection where immunity isn't swept" << endl
+		<< "  --seed N               seed for the sampling and the first replica at each point (default 1)" << endl
+		<< "  --threads N            worker threads, 0 for one per hardware thread (default 0)" << endl
+		<< "  --output FILE          where to write the results table (default sweep.csv)" << endl
+		<< "  --journal FILE         where finished points are kept for resuming (default: the output file plus .journal)" << endl;
+}
@@ -0,0 +1,129 @@
+#include "ThreadPool.h"
+
+//Creates a pool with the given number of threads in total, counting the thread that calls run(). Zero means one per hardware thread.
+ThreadPool::ThreadPool(int threads)
+{
+	if (threads <= 0) {
+		threads = (int)thread::hardware_concurrency();
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+
+	job = NULL;
+	job_context = NULL;
+	job_tasks = 0;
+	next_task = 0;
+	tasks_done = 0;
+	active_workers = 0;
+	batch = 0;
+	stopping = false;
+
+	//The calling thread is the first worker, so only start the rest
+	for (int worker = 1;worker < threads;worker++) {
+		workers.push_back(thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (int worker = 0;worker < workers.size();worker++) {
+		workers[worker].join();
+	}
+}
+
+int ThreadPool::size()
+{
+	return (int)workers.size() + 1;
+}
+
+//Takes tasks off the shared counter until there are none left and returns how many this thread finished
+int ThreadPool::workOnBatch(TaskFunction task, const void *context, int tasks)
+{
+	int done = 0;
+	for (int current = next_task++;current < tasks;current = next_task++) {
+		task(context, current);
+		done++;
+	}
+	return done;
+}
+
+void ThreadPool::workerLoop()
+{
+	unsigned long last_batch = 0;
+
+	while (true) {
+		TaskFunction task;
+		const void *context;
+		int tasks;
+
+		//Sleep until there is a new batch or the pool is shutting down
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [&] { return stopping || batch != last_batch; });
+			if (stopping) {
+				return;
+			}
+			last_batch = batch;
+
+			//The batch may already be over if this thread woke up late
+			if (job == NULL) {
+				continue;
+			}
+			task = job;
+			context = job_context;
+			tasks = job_tasks;
+			active_workers++;
+		}
+
+		int done = workOnBatch(task, context, tasks);
+
+		//Let run() know once the last task of the batch is done
+		unique_lock<mutex> guard(lock);
+		tasks_done += done;
+		active_workers--;
+		if (tasks_done == job_tasks && active_workers == 0) {
+			finished.notify_all();
+		}
+	}
+}
+
+//What run() does once it has a plain function to call
+void ThreadPool::runBatch(int tasks, TaskFunction task, const void *context)
+{
+	if (tasks <= 0) {
+		return;
+	}
+
+	//Not worth waking anyone up for a single task
+	if (workers.empty() || tasks == 1) {
+		for (int current = 0;current < tasks;current++) {
+			task(context, current);
+		}
+		return;
+	}
+
+	{
+		unique_lock<mutex> guard(lock);
+		job = task;
+		job_context = context;
+		job_tasks = tasks;
+		tasks_done = 0;
+		next_task = 0;
+		batch++;
+	}
+	wake.notify_all();
+
+	int done = workOnBatch(task, context, tasks);
+
+	unique_lock<mutex> guard(lock);
+	tasks_done += done;
+	finished.wait(guard, [&] { return tasks_done == job_tasks && active_workers == 0; });
+	job = NULL;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+using namespace std;
+
+//A fixed set of worker threads that split up a batch of numbered tasks between them. The thread that calls run() works on the
+//batch too, and doesn't return until every task is finished. Tasks are handed out one at a time from a shared counter, so a
+//slow task doesn't hold up the others, but it also means there is no guarantee which thread runs which task. Anything that
+//has to come out the same every time has to be written per task and combined afterwards in task order.
+class ThreadPool
+{
+	vector<thread> workers;
+	mutex lock;
+	condition_variable wake;
+	condition_variable finished;
+
+	//Calls the task object behind context for one task number
+	typedef void (*TaskFunction)(const void *context, int task);
+
+	//The batch currently being worked on
+	TaskFunction job;
+	const void *job_context;
+	int job_tasks;
+	atomic<int> next_task;
+	int tasks_done;
+	//How many workers are still inside the current batch. run() can't return until this is zero, or a late worker could
+	//end up using a task function that has already gone away.
+	int active_workers;
+	//Bumped for every new batch so sleeping workers can tell it apart from the last one
+	unsigned long batch;
+	bool stopping;
+
+	void workerLoop();
+	int workOnBatch(TaskFunction task, const void *context, int tasks);
+	void runBatch(int tasks, TaskFunction task, const void *context);
+
+	template <class Task>
+	static void callTask(const void *context, int task)
+	{
+		(*(const Task *)context)(task);
+	}
+
+public:
+	ThreadPool(int threads = 0);
+	~ThreadPool();
+	int size();
+
+	//Runs task(0) through task(tasks - 1) across the pool and waits for all of them to finish. The workers only get a pointer to
+	//the task, so unlike a std::function nothing is copied or allocated however much the lambda captures.
+	template <class Task>
+	void run(int tasks, const Task &task)
+	{
+		runBatch(tasks, &callTask<Task>, &task);
+	}
+};
@@ -0,0 +1,260 @@
+#include "TimeSeries.h"
+
+//Waiting for blocks and writing the CSV
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+//How many blocks can be waiting in each direction at once. At 4096 ticks a block, this is over a million ticks of slack.
+#define TIME_SERIES_QUEUE 256
+
+static const char series_magic[8] = { 'C', 'M', 'S', 'E', 'R', 'I', 'E', 'S' };
+
+//Column names in the file are stored in fixed fields of this many bytes
+#define SERIES_NAME_LENGTH 16
+static const char *series_names[SERIES_COLUMNS] = { "susceptible", "infected", "recovered", "new_infections", "new_recoveries" };
+
+TimeSeriesWriter::TimeSeriesWriter() : full_blocks(TIME_SERIES_QUEUE), empty_blocks(TIME_SERIES_QUEUE)
+{
+	file = NULL;
+	current = NULL;
+	closing = false;
+	failed = false;
+}
+
+TimeSeriesWriter::~TimeSeriesWriter()
+{
+	string error;
+	close(error);
+}
+
+//Starts a new file, replacing anything already at the path, and starts the writer thread
+bool TimeSeriesWriter::open(const string &path, string &error)
+{
+	close(error);
+
+	file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		error = "Failed to open " + path;
+		return false;
+	}
+
+	unsigned int version = TIME_SERIES_VERSION;
+	unsigned int columns = SERIES_COLUMNS;
+	char names[SERIES_COLUMNS][SERIES_NAME_LENGTH];
+	memset(names, 0, sizeof(names));
+	for (int column = 0;column < SERIES_COLUMNS;column++) {
+		strncpy(names[column], series_names[column], SERIES_NAME_LENGTH - 1);
+	}
+	fwrite(series_magic, 1, sizeof(series_magic), file);
+	fwrite(&version, sizeof(version), 1, file);
+	fwrite(&columns, sizeof(columns), 1, file);
+	if (fwrite(names, 1, sizeof(names), file) != sizeof(names)) {
+		fclose(file);
+		file = NULL;
+		error = "Failed to write " + path;
+		return false;
+	}
+
+	closing = false;
+	failed = false;
+	writer = thread(&TimeSeriesWriter::writerLoop, this);
+	return true;
+}
+
+bool TimeSeriesWriter::isOpen()
+{
+	return file != NULL;
+}
+
+//Adds a tick's counts. Only ever called from the one simulation thread.
+void TimeSeriesWriter::record(unsigned long long tick, unsigned int susceptible, unsigned int infected, unsigned int recovered, unsigned int new_infections, unsigned int new_recoveries)
+{
+	if (file == NULL) {
+		return;
+	}
+
+	//A jump in the ticks (the simulation was restarted, say) starts a new block, since a block's ticks have to follow on
+	if (current != NULL && tick != current->first_tick + current->rows) {
+		handOff();
+	}
+
+	if (current == NULL) {
+		if (!empty_blocks.pop(current)) {
+			current = new TimeSeriesBlock;
+			all_blocks.push_back(current);
+		}
+		current->first_tick = tick;
+		current->rows = 0;
+	}
+
+	unsigned int row = current->rows;
+	current->columns[SERIES_SUSCEPTIBLE][row] = susceptible;
+	current->columns[SERIES_INFECTED][row] = infected;
+	current->columns[SERIES_RECOVERED][row] = recovered;
+	current->columns[SERIES_NEW_INFECTIONS][row] = new_infections;
+	current->columns[SERIES_NEW_RECOVERIES][row] = new_recoveries;
+	current->rows++;
+
+	if (current->rows == TIME_SERIES_BLOCK) {
+		handOff();
+	}
+}
+
+//Sends the current block to the writer thread, after any that were already waiting for room in the queue
+void TimeSeriesWriter::handOff()
+{
+	if (current != NULL && current->rows > 0) {
+		backlog.push_back(current);
+	}
+	current = NULL;
+
+	int sent = 0;
+	while (sent < backlog.size() && full_blocks.push(backlog[sent])) {
+		sent++;
+	}
+	backlog.erase(backlog.begin(), backlog.begin() + sent);
+}
+
+void TimeSeriesWriter::writerLoop()
+{
+	while (true) {
+		TimeSeriesBlock *block;
+		if (!full_blocks.pop(block)) {
+			//Only stop once the queue is empty after being told to, so nothing handed off before close() is lost
+			if (closing.load(memory_order_acquire)) {
+				if (!full_blocks.pop(block)) {
+					return;
+				}
+			}
+			else {
+				this_thread::sleep_for(chrono::milliseconds(1));
+				continue;
+			}
+		}
+
+		unsigned int reserved = 0;
+		bool written = fwrite(&block->first_tick, sizeof(block->first_tick), 1, file) == 1;
+		written = fwrite(&block->rows, sizeof(block->rows), 1, file) == 1 && written;
+		written = fwrite(&reserved, sizeof(reserved), 1, file) == 1 && written;
+		for (int column = 0;column < SERIES_COLUMNS;column++) {
+			written = fwrite(block->columns[column], sizeof(unsigned int), block->rows, file) == block->rows && written;
+		}
+		if (!written) {
+			failed = true;
+		}
+
+		//If the return queue is full the block just isn't reused. It's still freed at the end.
+		empty_blocks.push(block);
+	}
+}
+
+//Writes out everything recorded so far, stops the writer thread and closes the file. Returns false if anything failed to write.
+bool TimeSeriesWriter::close(string &error)
+{
+	if (file == NULL) {
+		return true;
+	}
+
+	//Nothing else is being recorded now, so it's fine to wait for the queue to have room for the last blocks
+	handOff();
+	while (!backlog.empty()) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+		handOff();
+	}
+
+	closing.store(true, memory_order_release);
+	writer.join();
+
+	bool ok = !failed && fclose(file) == 0;
+	file = NULL;
+
+	TimeSeriesBlock *block;
+	while (empty_blocks.pop(block)) {
+	}
+	for (int index = 0;index < all_blocks.size();index++) {
+		delete all_blocks[index];
+	}
+	all_blocks.clear();
+
+	if (!ok) {
+		error = "Failed to write the time series";
+	}
+	return ok;
+}
+
+//Turns a time series file into a CSV table with a row per tick. Stops quietly at a block that was cut short.
+bool convertTimeSeriesToCsv(const string &input_path, const string &output_path, string &error)
+{
+	FILE *input = fopen(input_path.c_str(), "rb");
+	if (input == NULL) {
+		error = "Failed to open " + input_path;
+		return false;
+	}
+
+	char magic[8];
+	unsigned int version;
+	unsigned int columns;
+	if (fread(magic, 1, sizeof(magic), input) != sizeof(magic) || memcmp(magic, series_magic, sizeof(magic)) != 0 ||
+		fread(&version, sizeof(version), 1, input) != 1 || fread(&columns, sizeof(columns), 1, input) != 1) {
+		fclose(input);
+		error = input_path + " isn't a time series";
+		return false;
+	}
+	if (version != TIME_SERIES_VERSION || columns == 0 || columns > 64) {
+		fclose(input);
+		error = input_path + " is from a different version of the program";
+		return false;
+	}
+
+	vector<char> names(columns * SERIES_NAME_LENGTH);
+	if (fread(names.data(), 1, names.size(), input) != names.size()) {
+		fclose(input);
+		error = input_path + " is incomplete";
+		return false;
+	}
+
+	ofstream output(output_path.c_str());
+	if (!output) {
+		fclose(input);
+		error = "Failed to open " + output_path;
+		return false;
+	}
+
+	output << "tick";
+	for (int column = 0;column < columns;column++) {
+		output << "," << string(&names[column * SERIES_NAME_LENGTH], strnlen(&names[column * SERIES_NAME_LENGTH], SERIES_NAME_LENGTH));
+	}
+	output << "\n";
+
+	vector<unsigned int> values;
+	while (true) {
+		unsigned long long first_tick;
+		unsigned int rows;
+		unsigned int reserved;
+		if (fread(&first_tick, sizeof(first_tick), 1, input) != 1 || fread(&rows, sizeof(rows), 1, input) != 1 ||
+			fread(&reserved, sizeof(reserved), 1, input) != 1 || rows > TIME_SERIES_BLOCK) {
+			break;
+		}
+
+		values.resize((size_t)columns * rows);
+		if (fread(values.data(), sizeof(unsigned int), values.size(), input) != values.size()) {
+			break;
+		}
+
+		for (unsigned int row = 0;row < rows;row++) {
+			output << first_tick + row;
+			for (unsigned int column = 0;column < columns;column++) {
+				output << "," << values[(size_t)column * rows + row];
+			}
+			output << "\n";
+		}
+	}
+
+	fclose(input);
+	if (!output.good()) {
+		error = "Failed to write " + output_path;
+		return false;
+	}
+	return true;
+}
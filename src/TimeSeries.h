@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include "SpscQueue.h"
+using namespace std;
+
+//Records the S/I/R counts, new infections and new recoveries of every tick to a binary file, written by a background thread.
+//
+//The file starts with a header naming the columns, followed by blocks of up to TIME_SERIES_BLOCK ticks. Each block gives the
+//tick its first row belongs to and how many rows it has, then stores each column as one array of 32 bit counts. Keeping the
+//columns apart means a reader after a single count only has to touch that column. A file cut short by a crash is still readable
+//up to its last whole block.
+//
+//The simulation thread fills a block in memory and hands it to the writer thread through a lock-free queue, and the writer thread
+//hands empty blocks back the same way, so recording a tick is just five stores and never waits on the disk. If the disk falls
+//behind, full blocks pile up in memory on the simulation side until the queue has room again.
+
+#define TIME_SERIES_VERSION 1
+#define TIME_SERIES_BLOCK 4096
+
+enum TimeSeriesColumn
+{
+	SERIES_SUSCEPTIBLE,
+	SERIES_INFECTED,
+	SERIES_RECOVERED,
+	SERIES_NEW_INFECTIONS,
+	SERIES_NEW_RECOVERIES,
+	SERIES_COLUMNS
+};
+
+struct TimeSeriesBlock
+{
+	unsigned long long first_tick;
+	unsigned int rows;
+	unsigned int columns[SERIES_COLUMNS][TIME_SERIES_BLOCK];
+};
+
+class TimeSeriesWriter
+{
+	FILE *file;
+	thread writer;
+	atomic<bool> closing;
+	atomic<bool> failed;
+
+	//Full blocks on their way to the disk, and empty ones on their way back
+	SpscQueue<TimeSeriesBlock *> full_blocks;
+	SpscQueue<TimeSeriesBlock *> empty_blocks;
+
+	//Owned by the simulation thread: the block being filled, and full blocks the queue didn't have room for yet
+	TimeSeriesBlock *current;
+	vector<TimeSeriesBlock *> backlog;
+	//Every block ever made, so they can all be freed at the end
+	vector<TimeSeriesBlock *> all_blocks;
+
+	void writerLoop();
+	void handOff();
+
+public:
+	TimeSeriesWriter();
+	~TimeSeriesWriter();
+	bool open(const string &path, string &error);
+	bool isOpen();
+	void record(unsigned long long tick, unsigned int susceptible, unsigned int infected, unsigned int recovered, unsigned int new_infections, unsigned int new_recoveries);
+	bool close(string &error);
+};
+
+bool convertTimeSeriesToCsv(const string &input_path, const string &output_path, string &error);
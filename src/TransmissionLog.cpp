@@ -0,0 +1,401 @@
+#include "TransmissionLog.h"
+
+//Waiting for blocks and packing them
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+//How many blocks can be waiting in each direction at once
+#define TRANSMISSION_QUEUE 64
+
+//Bits per axis of a stored position
+#define POSITION_BITS 16
+#define POSITION_STEPS ((1 << POSITION_BITS) - 1)
+
+static const char transmission_magic[8] = { 'C', 'M', 'T', 'R', 'A', 'N', 'S', 'M' };
+
+//How many bits it takes to write the number
+static int bitsFor(unsigned long long value)
+{
+	int bits = 0;
+	while (value > 0) {
+		bits++;
+		value >>= 1;
+	}
+	return bits;
+}
+
+//Fills bytes with values of any width up to 32 bits, lowest bit first
+class BitWriter
+{
+	vector<unsigned char> &bytes;
+	unsigned long long bits;
+	int bit_count;
+
+public:
+	BitWriter(vector<unsigned char> &bytes) : bytes(bytes)
+	{
+		bits = 0;
+		bit_count = 0;
+	}
+
+	void write(unsigned long long value, int count)
+	{
+		bits |= value << bit_count;
+		bit_count += count;
+		while (bit_count >= 8) {
+			bytes.push_back((unsigned char)bits);
+			bits >>= 8;
+			bit_count -= 8;
+		}
+	}
+
+	//Elias gamma code of a number of at least one: one zero for each bit after the leading one, then the number itself
+	void writeGamma(unsigned long long value)
+	{
+		int length = bitsFor(value);
+		write(1ull << (length - 1), length);
+		write(value & ((1ull << (length - 1)) - 1), length - 1);
+	}
+
+	void finish()
+	{
+		if (bit_count > 0) {
+			bytes.push_back((unsigned char)bits);
+		}
+		bits = 0;
+		bit_count = 0;
+	}
+};
+
+static unsigned int quantizePosition(float position)
+{
+	return (unsigned int)lround((min(1.0f, max(-1.0f, position)) + 1.0f) * 0.5f * POSITION_STEPS);
+}
+
+static float unquantizePosition(unsigned int position)
+{
+	return position * 2.0f / POSITION_STEPS - 1.0f;
+}
+
+TransmissionLog::TransmissionLog() : full_blocks(TRANSMISSION_QUEUE), empty_blocks(TRANSMISSION_QUEUE)
+{
+	file = NULL;
+	current = NULL;
+	closing = false;
+	failed = false;
+}
+
+TransmissionLog::~TransmissionLog()
+{
+	string error;
+	close(error);
+}
+
+//Starts a new log, replacing anything already at the path, and starts the writer thread
+bool TransmissionLog::open(const string &path, string &error)
+{
+	close(error);
+
+	file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		error = "Failed to open " + path;
+		return false;
+	}
+
+	unsigned int version = TRANSMISSION_LOG_VERSION;
+	unsigned int position_bits = POSITION_BITS;
+	fwrite(transmission_magic, 1, sizeof(transmission_magic), file);
+	fwrite(&version, sizeof(version), 1, file);
+	if (fwrite(&position_bits, sizeof(position_bits), 1, file) != 1) {
+		fclose(file);
+		file = NULL;
+		error = "Failed to write " + path;
+		return false;
+	}
+
+	closing = false;
+	failed = false;
+	writer = thread(&TransmissionLog::writerLoop, this);
+	return true;
+}
+
+bool TransmissionLog::isOpen()
+{
+	return file != NULL;
+}
+
+//Adds a tick's infections. Only ever called from the one simulation thread.
+void TransmissionLog::record(const vector<Transmission> &transmissions)
+{
+	if (file == NULL) {
+		return;
+	}
+
+	for (int event = 0;event < transmissions.size();event++) {
+		//A block's ticks only ever go forwards, so going back (the simulation was restarted, say) starts a new one
+		if (current != NULL && transmissions[event].tick < current->events[current->count - 1].tick) {
+			handOff();
+		}
+
+		if (current == NULL) {
+			if (!empty_blocks.pop(current)) {
+				current = new TransmissionBlock;
+				all_blocks.push_back(current);
+			}
+			current->count = 0;
+		}
+
+		current->events[current->count] = transmissions[event];
+		current->count++;
+
+		if (current->count == TRANSMISSION_BLOCK) {
+			handOff();
+		}
+	}
+}
+
+//Sends the current block to the writer thread, after any that were already waiting for room in the queue
+void TransmissionLog::handOff()
+{
+	if (current != NULL && current->count > 0) {
+		backlog.push_back(current);
+	}
+	current = NULL;
+
+	int sent = 0;
+	while (sent < backlog.size() && full_blocks.push(backlog[sent])) {
+		sent++;
+	}
+	backlog.erase(backlog.begin(), backlog.begin() + sent);
+}
+
+void TransmissionLog::writerLoop()
+{
+	while (true) {
+		TransmissionBlock *block;
+		if (!full_blocks.pop(block)) {
+			//Only stop once the queue is empty after being told to, so nothing handed off before close() is lost
+			if (closing.load(memory_order_acquire)) {
+				if (!full_blocks.pop(block)) {
+					return;
+				}
+			}
+			else {
+				this_thread::sleep_for(chrono::milliseconds(1));
+				continue;
+			}
+		}
+
+		if (!writeBlock(block)) {
+			failed = true;
+		}
+
+		//If the return queue is full the block just isn't reused. It's still freed at the end.
+		empty_blocks.push(block);
+	}
+}
+
+//Packs a block and writes it out after a small header saying how to unpack it
+bool TransmissionLog::writeBlock(TransmissionBlock *block)
+{
+	unsigned int highest_id = 0;
+	for (unsigned int event = 0;event < block->count;event++) {
+		highest_id = max(highest_id, max(block->events[event].infector, block->events[event].infectee));
+	}
+
+	unsigned long long first_tick = block->events[0].tick;
+	unsigned int id_bits = max(1, bitsFor(highest_id));
+
+	packed.clear();
+	BitWriter writer(packed);
+	unsigned long long previous_tick = first_tick;
+	for (unsigned int event = 0;event < block->count;event++) {
+		const Transmission &transmission = block->events[event];
+		writer.writeGamma(transmission.tick - previous_tick + 1);
+		writer.write(transmission.infector, id_bits);
+		writer.write(transmission.infectee, id_bits);
+		writer.write(quantizePosition(transmission.x), POSITION_BITS);
+		writer.write(quantizePosition(transmission.y), POSITION_BITS);
+		previous_tick = transmission.tick;
+	}
+	writer.finish();
+
+	unsigned int byte_count = (unsigned int)packed.size();
+	unsigned int reserved = 0;
+	bool written = fwrite(&first_tick, sizeof(first_tick), 1, file) == 1;
+	written = fwrite(&block->count, sizeof(block->count), 1, file) == 1 && written;
+	written = fwrite(&id_bits, sizeof(id_bits), 1, file) == 1 && written;
+	written = fwrite(&byte_count, sizeof(byte_count), 1, file) == 1 && written;
+	written = fwrite(&reserved, sizeof(reserved), 1, file) == 1 && written;
+	written = fwrite(packed.data(), 1, packed.size(), file) == packed.size() && written;
+	return written;
+}
+
+//Writes out everything recorded so far, stops the writer thread and closes the file. Returns false if anything failed to write.
+bool TransmissionLog::close(string &error)
+{
+	if (file == NULL) {
+		return true;
+	}
+
+	//Nothing else is being recorded now, so it's fine to wait for the queue to have room for the last blocks
+	handOff();
+	while (!backlog.empty()) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+		handOff();
+	}
+
+	closing.store(true, memory_order_release);
+	writer.join();
+
+	bool ok = !failed && fclose(file) == 0;
+	file = NULL;
+
+	TransmissionBlock *block;
+	while (empty_blocks.pop(block)) {
+	}
+	for (int index = 0;index < all_blocks.size();index++) {
+		delete all_blocks[index];
+	}
+	all_blocks.clear();
+
+	if (!ok) {
+		error = "Failed to write the transmission log";
+	}
+	return ok;
+}
+
+TransmissionReader::TransmissionReader()
+{
+	file = NULL;
+	remaining = 0;
+}
+
+TransmissionReader::~TransmissionReader()
+{
+	if (file != NULL) {
+		fclose(file);
+	}
+}
+
+bool TransmissionReader::open(const string &path, string &error)
+{
+	if (file != NULL) {
+		fclose(file);
+	}
+	remaining = 0;
+
+	file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		error = "Failed to open " + path;
+		return false;
+	}
+
+	char magic[8];
+	unsigned int version;
+	unsigned int position_bits;
+	if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, transmission_magic, sizeof(magic)) != 0 ||
+		fread(&version, sizeof(version), 1, file) != 1 || fread(&position_bits, sizeof(position_bits), 1, file) != 1) {
+		error = path + " isn't a transmission log";
+		return false;
+	}
+	if (version != TRANSMISSION_LOG_VERSION || position_bits != POSITION_BITS) {
+		error = path + " is from a different version of the program";
+		return false;
+	}
+	return true;
+}
+
+//Loads the next whole block. Returns false at the end of the file, or at a block that was cut short.
+bool TransmissionReader::nextBlock()
+{
+	unsigned long long first_tick;
+	unsigned int count;
+	unsigned int bits_per_id;
+	unsigned int byte_count;
+	unsigned int reserved;
+	if (file == NULL || fread(&first_tick, sizeof(first_tick), 1, file) != 1 || fread(&count, sizeof(count), 1, file) != 1 ||
+		fread(&bits_per_id, sizeof(bits_per_id), 1, file) != 1 || fread(&byte_count, sizeof(byte_count), 1, file) != 1 ||
+		fread(&reserved, sizeof(reserved), 1, file) != 1 || count > TRANSMISSION_BLOCK || bits_per_id == 0 || bits_per_id > 32) {
+		return false;
+	}
+
+	packed.resize(byte_count);
+	if (fread(packed.data(), 1, packed.size(), file) != packed.size()) {
+		return false;
+	}
+
+	remaining = count;
+	id_bits = (int)bits_per_id;
+	previous_tick = first_tick;
+	next_byte = 0;
+	bits = 0;
+	bit_count = 0;
+	return true;
+}
+
+bool TransmissionReader::readBits(int count, unsigned long long &value)
+{
+	while (bit_count < count) {
+		if (next_byte == packed.size()) {
+			return false;
+		}
+		bits |= (unsigned long long)packed[next_byte] << bit_count;
+		next_byte++;
+		bit_count += 8;
+	}
+	value = bits & ((1ull << count) - 1);
+	bits >>= count;
+	bit_count -= count;
+	return true;
+}
+
+//Gets the next infection in the log. Returns false once there are none left.
+bool TransmissionReader::next(Transmission &transmission)
+{
+	while (remaining == 0) {
+		if (!nextBlock()) {
+			return false;
+		}
+	}
+
+	//The gap in ticks, as an Elias gamma code
+	unsigned long long bit;
+	int length = 1;
+	while (true) {
+		if (!readBits(1, bit)) {
+			return false;
+		}
+		if (bit == 1) {
+			break;
+		}
+		length++;
+		if (length > 33) {
+			return false;
+		}
+	}
+	unsigned long long gap = 0;
+	if (length > 1 && !readBits(length - 1, gap)) {
+		return false;
+	}
+	gap |= 1ull << (length - 1);
+
+	unsigned long long infector;
+	unsigned long long infectee;
+	unsigned long long x;
+	unsigned long long y;
+	if (!readBits(id_bits, infector) || !readBits(id_bits, infectee) || !readBits(POSITION_BITS, x) || !readBits(POSITION_BITS, y)) {
+		return false;
+	}
+
+	previous_tick += gap - 1;
+	transmission.tick = (unsigned int)previous_tick;
+	transmission.infector = (unsigned int)infector;
+	transmission.infectee = (unsigned int)infectee;
+	transmission.x = unquantizePosition((unsigned int)x);
+	transmission.y = unquantizePosition((unsigned int)y);
+	remaining--;
+	return true;
+}
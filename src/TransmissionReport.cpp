@@ -0,0 +1,107 @@
+//Turns a transmission log recorded by the simulation (Headless --transmissions, or Record Transmissions in the window) into the
+//transmission tree, the number of people each agent infected, and the generation intervals.
+//
+//The log is read one infection at a time, and only a few numbers are kept per agent, so logs of millions of infections fit easily.
+//Agents that were already infected when the log started (the first case, or everyone infected before a resume) are the roots of
+//the tree. Their generation is zero and, since when they caught it isn't in the log, their infections have no generation interval.
+
+//Allows output messages
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+//Reading the binary format
+#include "TransmissionLog.h"
+
+using namespace std;
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		cout << "Usage: TransmissionReport INPUT PREFIX" << endl
+			<< "  INPUT                  transmission log written by the simulation" << endl
+			<< "  PREFIX                 writes PREFIX_tree.csv with one row per infection and PREFIX_secondary.csv with one row per agent" << endl;
+		return argc == 2 && string(argv[1]) == "--help" ? 0 : 1;
+	}
+
+	string error;
+	TransmissionReader reader;
+	if (!reader.open(argv[1], error)) {
+		cout << error << endl;
+		return 1;
+	}
+
+	string prefix = argv[2];
+	ofstream tree((prefix + "_tree.csv").c_str());
+	if (!tree) {
+		cout << "Failed to open " << prefix << "_tree.csv" << endl;
+		return 1;
+	}
+	tree << "tick,infector,infectee,x,y,generation,generation_interval\n";
+
+	//For each agent: the tick and generation of their latest infection (-1 if it isn't in the log), and how many they infected
+	vector<long long> infected_at;
+	vector<int> generation;
+	vector<unsigned int> secondary_cases;
+
+	unsigned long long transmissions = 0;
+	unsigned long long known_intervals = 0;
+	double interval_sum = 0.0;
+	int deepest_generation = 0;
+
+	Transmission transmission;
+	while (reader.next(transmission)) {
+		unsigned int highest = max(transmission.infector, transmission.infectee);
+		if (highest >= infected_at.size()) {
+			infected_at.resize(highest + 1, -1);
+			generation.resize(highest + 1, 0);
+			secondary_cases.resize(highest + 1, 0);
+		}
+
+		unsigned int infector = transmission.infector;
+		unsigned int infectee = transmission.infectee;
+		secondary_cases[infector]++;
+		generation[infectee] = generation[infector] + 1;
+		deepest_generation = max(deepest_generation, generation[infectee]);
+
+		tree << transmission.tick << "," << infector << "," << infectee << "," << transmission.x << "," << transmission.y << "," << generation[infectee] << ",";
+		if (infected_at[infector] >= 0) {
+			long long interval = transmission.tick - infected_at[infector];
+			tree << interval;
+			interval_sum += interval;
+			known_intervals++;
+		}
+		tree << "\n";
+
+		infected_at[infectee] = transmission.tick;
+		transmissions++;
+	}
+
+	ofstream secondary((prefix + "_secondary.csv").c_str());
+	if (!secondary) {
+		cout << "Failed to open " << prefix << "_secondary.csv" << endl;
+		return 1;
+	}
+	secondary << "agent,generation,secondary_cases\n";
+
+	//Everyone who was ever infected, whether or not they passed it on
+	unsigned long long cases = 0;
+	for (unsigned int agent = 0;agent < secondary_cases.size();agent++) {
+		if (infected_at[agent] >= 0 || secondary_cases[agent] > 0) {
+			secondary << agent << "," << generation[agent] << "," << secondary_cases[agent] << "\n";
+			cases++;
+		}
+	}
+
+	if (!tree.good() || !secondary.good()) {
+		cout << "Failed to write " << prefix << "_tree.csv or " << prefix << "_secondary.csv" << endl;
+		return 1;
+	}
+
+	cout << "transmissions,cases,mean_secondary_cases,generations,mean_generation_interval" << endl
+		<< transmissions << "," << cases << "," << (cases > 0 ? (double)transmissions / cases : 0.0) << "," << deepest_generation << ","
+		<< (known_intervals > 0 ? interval_sum / known_intervals : 0.0) << endl;
+	return 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+using namespace std;
+
+//Hands the latest version of something from one thread that writes it to one thread that reads it, without either ever waiting on
+//the other. There are three copies: the writer fills its own, then swaps it with the spare in one step. The reader swaps its own
+//for the spare whenever a newer one has been put there. Versions the reader never got round to are simply skipped, and the reader
+//always has a complete one to look at, never one that's half written.
+template <class T>
+class TripleBuffer
+{
+	T buffers[3];
+
+	//Which copy is the spare, with the top bit set if it's newer than what the reader has
+	atomic<int> spare;
+	int writing;
+	int reading;
+
+	static const int FRESH = 4;
+
+public:
+	TripleBuffer()
+	{
+		writing = 0;
+		spare = 1;
+		reading = 2;
+	}
+
+	//Writer only. The copy to fill in. It still holds an older version, so all of it has to be written over, but any memory it
+	//owns can be reused.
+	T &back()
+	{
+		return buffers[writing];
+	}
+
+	//Writer only. Hands over the copy that was just filled in.
+	void publish()
+	{
+		writing = spare.exchange(writing | FRESH, memory_order_acq_rel) & ~FRESH;
+	}
+
+	//Reader only. Picks up the newest copy, if one has been handed over since last time, and returns whether it did.
+	bool update()
+	{
+		if ((spare.load(memory_order_relaxed) & FRESH) == 0) {
+			return false;
+		}
+		reading = spare.exchange(reading, memory_order_acq_rel) & ~FRESH;
+		return true;
+	}
+
+	//Reader only. The newest complete copy picked up by update().
+	const T &front()
+	{
+		return buffers[reading];
+	}
+};